@@ -0,0 +1,125 @@
+#include <boids.h>
+#include <hierarchy.h>
+#include <parallel.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define BOID_COUNT 100000
+#define FRAMES 120
+#define WARMUP_FRAMES 10
+
+// Flocks BOID_COUNT entities through the ECS with neighbours from the
+// spatial grid. Grid queries are checked against a brute-force scan for a
+// sample of boids before any time is reported.
+static bool verify(const SpatialGrid & grid, float radius)
+{
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(grid.Size() - 1));
+
+    std::vector<std::uint32_t> found;
+    for (int sample = 0; sample < 200; ++sample)
+    {
+        glm::vec3 center = grid.Position(pick(rng));
+
+        found.clear();
+        grid.QueryRadius(center, radius, found);
+
+        std::size_t expected = 0;
+        for (std::uint32_t slot = 0; slot < grid.Size(); ++slot)
+        {
+            glm::vec3 d = grid.Position(slot) - center;
+            expected += glm::dot(d, d) <= radius * radius;
+        }
+
+        if (found.size() != expected)
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    ECS ecs;
+    ecs.init();
+    ecs.registerComponent<Transform>();
+    ecs.registerComponent<Parent>();
+    ecs.registerComponent<Children>();
+    ecs.registerComponent<Boid>();
+
+    BoidSettings settings;
+
+    auto hierarchy = ecs.registerSystem<HierarchySystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        ecs.setSystemSignature<HierarchySystem>(signature);
+    }
+    hierarchy->Init(&ecs);
+
+    auto grid = ecs.registerSystem<SpatialGridSystem>();
+    auto boids = ecs.registerSystem<BoidSystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        signature.set(ecs.getComponentType<Boid>());
+        ecs.setSystemSignature<SpatialGridSystem>(signature);
+        ecs.setSystemSignature<BoidSystem>(signature);
+    }
+    grid->Init(&ecs, settings.radius);
+    boids->Init(&ecs, grid, hierarchy, settings);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-settings.worldHalfSize, settings.worldHalfSize);
+    std::uniform_real_distribution<float> speed(-settings.maxSpeed, settings.maxSpeed);
+
+    for (int i = 0; i < BOID_COUNT; ++i)
+    {
+        Entity entity = ecs.createEntity();
+
+        Transform transform;
+        transform.local[3] = glm::vec4(position(rng), position(rng), 0.0f, 1.0f);
+        transform.world = transform.local;
+        ecs.addComponent(entity, transform);
+        ecs.addComponent(entity, Boid{glm::vec3(speed(rng), speed(rng), 0.0f)});
+    }
+
+    hierarchy->Propagate();
+    grid->Update();
+    bool correct = verify(grid->Grid(), settings.radius);
+
+    double gather = 0.0, build = 0.0, boidGather = 0.0, steer = 0.0, write = 0.0, propagate = 0.0, neighbours = 0.0;
+    for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; ++frame)
+    {
+        grid->Update();
+        boids->Update(1.0f / 60.0f);
+        auto propagateStart = std::chrono::steady_clock::now();
+        hierarchy->Propagate();
+        double propagateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - propagateStart).count();
+
+        if (frame < WARMUP_FRAMES)
+            continue;
+
+        gather += grid->Stats().gatherMs;
+        build += grid->Stats().buildMs;
+        boidGather += boids->Stats().gatherMs;
+        steer += boids->Stats().steerMs;
+        write += boids->Stats().writeMs;
+        propagate += propagateMs;
+        neighbours += boids->Stats().averageNeighbours;
+    }
+
+    std::printf("boids %d  threads %u  frames %d  avg neighbours %.1f  grid %s\n",
+                BOID_COUNT, Parallel::ThreadCount(), FRAMES, neighbours / FRAMES, correct ? "ok" : "MISMATCH");
+    std::printf("grid gather    %8.3f ms\n", gather / FRAMES);
+    std::printf("grid build     %8.3f ms\n", build / FRAMES);
+    std::printf("boid gather    %8.3f ms\n", boidGather / FRAMES);
+    std::printf("boid steer     %8.3f ms\n", steer / FRAMES);
+    std::printf("boid write     %8.3f ms\n", write / FRAMES);
+    std::printf("propagate      %8.3f ms\n", propagate / FRAMES);
+    std::printf("total          %8.3f ms/frame\n", (gather + build + boidGather + steer + write + propagate) / FRAMES);
+
+    return correct ? 0 : 1;
+}
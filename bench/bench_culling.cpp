@@ -0,0 +1,65 @@
+#include <culling.h>
+#include <camera.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Times the SoA frustum culling kernels over random bounds. Every kernel is
+// checked against the scalar one before its time is reported.
+static void run(std::size_t count, const Frustum & frustum)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    BoundsSoA bounds;
+    bounds.Resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng) - 50.0f);
+        if (i % 2)
+            bounds.Set(i, center, size(rng), glm::vec3(0.0f));
+        else
+            bounds.Set(i, center, 0.0f, glm::vec3(size(rng), size(rng), size(rng)));
+    }
+
+    std::vector<std::uint8_t> reference(count), visible(count);
+    std::size_t expected = Culling::CullBounds(frustum, bounds, reference.data(), Culling::Kernel::Scalar);
+
+    const Culling::Kernel best = Culling::BestKernel();
+    for (Culling::Kernel kernel : {Culling::Kernel::Scalar, Culling::Kernel::SSE, Culling::Kernel::AVX})
+    {
+        if (kernel > best)
+            continue;
+
+        const int iterations = count >= 1000000 ? 20 : 200;
+        std::size_t result = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            result = Culling::CullBounds(frustum, bounds, visible.data(), kernel);
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+        bool match = result == expected && visible == reference;
+
+        std::printf("%-8zu %-7s visible %-8zu culled %-8zu %8.3f ms  %6.2f ns/bound  %s\n",
+                    count, Culling::KernelName(kernel), result, count - result, ms,
+                    ms * 1e6 / count, match ? "ok" : "MISMATCH");
+    }
+}
+
+int main()
+{
+    Camera camera;
+    camera.LookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.SetPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    camera.UpdateMatrices();
+
+    for (std::size_t count : {100000u, 1000000u})
+        run(count, camera.frustum);
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+#include <nomad_entity.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#define REPETITIONS 15
+// Repetitions at or above LARGE_SCENE entities, which take seconds each
+#define LARGE_REPETITIONS 7
+#define LARGE_SCENE 1000000
+// Percent a median may slow down against the baseline before it fails
+#define REGRESSION_THRESHOLD 15.0
+// A change must also exceed this many times the interquartile spread, in
+// percent of the median, of whichever run was noisier
+#define NOISE_MULTIPLIER 2.0
+#define MATCH_SYSTEMS 8
+
+// Microbenchmarks of nomad_entity.hpp at 1k to 1M entities. Needs neither
+// SDL nor GL. Writes CSV to stdout with the fastest and the median
+// repetition and the spread between the quartiles.
+//
+//     ./bench_ecs > baseline.csv
+//     ./bench_ecs --baseline baseline.csv --threshold 15
+//
+// With a baseline, medians are compared. A row regresses when its median
+// grew by more than both the threshold and the noise floor the two spreads
+// give; the exit code is 1 if anything regressed.
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+struct Health { float value; };
+struct Tag { std::uint32_t value; };
+
+// Systems only exist to be matched and iterated
+struct View1 : System {};
+struct View2 : System {};
+struct View4 : System {};
+template <int N>
+struct Matcher : System {};
+
+struct Sample
+{
+    std::size_t ops = 0;
+    std::vector<double> ns;
+};
+
+static volatile float sink;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+struct World
+{
+    std::unique_ptr<ECS> ecs;
+    std::shared_ptr<View1> view1;
+    std::shared_ptr<View2> view2;
+    std::shared_ptr<View4> view4;
+};
+
+static World makeWorld()
+{
+    World world;
+    world.ecs = std::make_unique<ECS>();
+    ECS * ecs = world.ecs.get();
+    ecs->init();
+    ecs->registerComponent<Position>();
+    ecs->registerComponent<Velocity>();
+    ecs->registerComponent<Health>();
+    ecs->registerComponent<Tag>();
+
+    world.view1 = ecs->registerSystem<View1>();
+    world.view2 = ecs->registerSystem<View2>();
+    world.view4 = ecs->registerSystem<View4>();
+
+    Signature one, two, four;
+    one.set(ecs->getComponentType<Position>());
+    two = one;
+    two.set(ecs->getComponentType<Velocity>());
+    four = two;
+    four.set(ecs->getComponentType<Health>());
+    four.set(ecs->getComponentType<Tag>());
+    ecs->setSystemSignature<View1>(one);
+    ecs->setSystemSignature<View2>(two);
+    ecs->setSystemSignature<View4>(four);
+    return world;
+}
+
+template <int N>
+static void registerMatchers(SystemManager & systems, std::vector<std::shared_ptr<System>> & out)
+{
+    if constexpr (N > 0)
+    {
+        out.push_back(systems.registerSystem<Matcher<N>>());
+        Signature signature;
+        signature.set(N % 4);
+        signature.set((N + 1) % 4);
+        systems.setSignature<Matcher<N>>(signature);
+        registerMatchers<N - 1>(systems, out);
+    }
+}
+
+// One repetition of every benchmark at count entities, in the order a scene
+// lives through them
+static void runOnce(std::size_t count, std::map<std::string, Sample> & samples, std::mt19937 & rng)
+{
+    auto record = [&](const char * name, std::size_t ops, double ns) {
+        Sample & sample = samples[name];
+        sample.ops = ops;
+        sample.ns.push_back(ns / ops);
+    };
+
+    World world = makeWorld();
+    ECS * ecs = world.ecs.get();
+    std::vector<Entity> entities;
+    entities.reserve(count);
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < count; ++i)
+        entities.push_back(ecs->createEntity());
+    record("create", count, elapsedNs(start));
+
+    start = Clock::now();
+    for (auto entity : entities)
+    {
+        ecs->addComponent(entity, Position{1.0f, 2.0f, 3.0f});
+        ecs->addComponent(entity, Velocity{0.1f, 0.2f, 0.3f});
+        ecs->addComponent(entity, Health{100.0f});
+        ecs->addComponent(entity, Tag{7});
+    }
+    record("add", 4 * count, elapsedNs(start));
+
+    float sum = 0.0f;
+    start = Clock::now();
+    for (auto entity : entities)
+        sum += ecs->getComponent<Position>(entity).x;
+    record("get", count, elapsedNs(start));
+
+    std::vector<Entity> shuffled = entities;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    start = Clock::now();
+    for (auto entity : shuffled)
+        sum += ecs->getComponent<Position>(entity).x;
+    record("random_get", count, elapsedNs(start));
+
+    auto const & view1 = world.view1;
+    start = Clock::now();
+    for (auto entity : view1->mEntities)
+        sum += ecs->getComponent<Position>(entity).x;
+    record("view_1", view1->mEntities.size(), elapsedNs(start));
+
+    auto const & view2 = world.view2;
+    start = Clock::now();
+    for (auto entity : view2->mEntities)
+    {
+        auto & position = ecs->getComponent<Position>(entity);
+        auto const & velocity = ecs->getComponent<Velocity>(entity);
+        position.x += velocity.x;
+        position.y += velocity.y;
+        position.z += velocity.z;
+    }
+    record("view_2", view2->mEntities.size(), elapsedNs(start));
+
+    auto const & view4 = world.view4;
+    start = Clock::now();
+    for (auto entity : view4->mEntities)
+    {
+        auto & position = ecs->getComponent<Position>(entity);
+        auto const & velocity = ecs->getComponent<Velocity>(entity);
+        auto & health = ecs->getComponent<Health>(entity);
+        auto const & tag = ecs->getComponent<Tag>(entity);
+        position.x += velocity.x;
+        health.value -= static_cast<float>(tag.value) * 0.001f;
+    }
+    record("view_4", view4->mEntities.size(), elapsedNs(start));
+
+    start = Clock::now();
+    for (auto entity : entities)
+        ecs->removeComponent<Velocity>(entity);
+    record("remove", count, elapsedNs(start));
+
+    start = Clock::now();
+    for (auto entity : entities)
+        ecs->destroyEntity(entity);
+    record("destroy", count, elapsedNs(start));
+
+    // Matching alone: every entity's signature against MATCH_SYSTEMS systems
+    SystemManager systems;
+    std::vector<std::shared_ptr<System>> matchers;
+    registerMatchers<MATCH_SYSTEMS>(systems, matchers);
+    start = Clock::now();
+    for (std::size_t i = 0; i < count; ++i)
+        systems.entitySignatureChanged(Entity(static_cast<int>(i)), Signature(i & 0xF));
+    record("system_match", count, elapsedNs(start));
+
+    sink = sum;
+}
+
+struct Baseline
+{
+    double median;
+    double spread;
+};
+
+static bool loadBaseline(const char * path, std::map<std::string, Baseline> & baseline)
+{
+    std::FILE * file = std::fopen(path, "r");
+    if (!file)
+        return false;
+
+    char line[512];
+    char name[128];
+    unsigned long long entities, ops;
+    double best;
+    Baseline row;
+    while (std::fgets(line, sizeof(line), file))
+    {
+        row.spread = 0.0;
+        if (std::sscanf(line, "%127[^,],%llu,%llu,%lf,%lf,%lf", name, &entities, &ops, &best, &row.median, &row.spread) >= 5)
+            baseline[std::string(name) + "/" + std::to_string(entities)] = row;
+    }
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    const char * baselinePath = nullptr;
+    double threshold = REGRESSION_THRESHOLD;
+    std::size_t maxEntities = MAX_ENTITIES;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+            baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+            threshold = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--max-entities") == 0 && hasValue)
+            maxEntities = std::min<std::size_t>(std::strtoull(argv[++i], nullptr, 10), MAX_ENTITIES);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--baseline <csv>] [--threshold <percent>] [--max-entities <n>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::map<std::string, Baseline> baseline;
+    if (baselinePath && !loadBaseline(baselinePath, baseline))
+    {
+        std::fprintf(stderr, "Could not read baseline %s\n", baselinePath);
+        return 2;
+    }
+
+    std::printf("benchmark,entities,ops,ns_per_op,median_ns_per_op,spread_pct");
+    if (baselinePath)
+        std::printf(",baseline_median_ns_per_op,change_pct,limit_pct,status");
+    std::printf("\n");
+
+    std::mt19937 rng(1234);
+    int regressions = 0;
+    for (std::size_t count = 1000; count <= maxEntities; count *= 10)
+    {
+        std::map<std::string, Sample> samples;
+        int repetitions = count >= LARGE_SCENE ? LARGE_REPETITIONS : REPETITIONS;
+        for (int r = 0; r < repetitions; ++r)
+            runOnce(count, samples, rng);
+
+        for (auto & entry : samples)
+        {
+            std::vector<double> & ns = entry.second.ns;
+            std::sort(ns.begin(), ns.end());
+            double best = ns.front();
+            double median = ns[ns.size() / 2];
+            double spread = (ns[ns.size() * 3 / 4] - ns[ns.size() / 4]) / median * 100.0;
+
+            std::printf("%s,%zu,%zu,%.2f,%.2f,%.1f", entry.first.c_str(), count, entry.second.ops, best, median, spread);
+            if (baselinePath)
+            {
+                auto found = baseline.find(entry.first + "/" + std::to_string(count));
+                if (found == baseline.end())
+                {
+                    std::printf(",,,new");
+                }
+                else
+                {
+                    double change = (median / found->second.median - 1.0) * 100.0;
+                    double limit = std::max(threshold, NOISE_MULTIPLIER * std::max(spread, found->second.spread));
+                    bool regressed = change > limit;
+                    regressions += regressed;
+                    std::printf(",%.2f,%+.1f,%.1f,%s", found->second.median, change, limit, regressed ? "regressed" : "ok");
+                }
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+    }
+
+    if (baselinePath)
+        std::fprintf(stderr, "%d benchmark%s regressed more than %.1f%% and the noise floor\n", regressions,
+                     regressions == 1 ? "" : "s", threshold);
+    return regressions ? 1 : 0;
+}
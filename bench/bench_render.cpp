@@ -0,0 +1,256 @@
+#include <renderer.h>
+#include <recording_device.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Times Renderer submission against the recording device, so no GPU or
+// window is needed. Every frame's recorded draws are checked: one multi-draw
+// per material, one command per mesh within it, and every instance read by a
+// command carries that command's mesh and material.
+//
+// Each size is also replayed the way frames were drawn before batching: per
+// entity a program bind, model, view, projection and color uniforms, a VAO
+// bind and one draw. Both are printed side by side with the reduction in
+// draws and device calls. Submitted bytes are uniform data per entity and
+// instance and command data batched. Recorded calls cost next to nothing, so
+// the times understate what each call saves on a real driver.
+static const int MATERIALS = 4;
+
+struct Result
+{
+    std::size_t draws = 0;
+    std::size_t calls = 0;
+    std::size_t uniforms = 0;
+    // Redundant calls GLState dropped before they reached the device
+    std::size_t elided = 0;
+    std::size_t bytes = 0;
+    double ms = 0.0;
+    bool ok = true;
+};
+
+static void print(const char * path, std::size_t count, const Result & result)
+{
+    std::printf("%-8zu %-10s draws %-7zu device calls %-7zu elided %-4zu uniforms %-7zu submitted %-9zu %8.3f ms  %6.2f ns/instance  %s\n",
+                count, path, result.draws, result.calls, result.elided, result.uniforms, result.bytes, result.ms,
+                result.ms * 1e6 / count, result.ok ? "ok" : "MISMATCH");
+}
+
+static bool verify(const RecordingDevice & device, const std::vector<ResourceLoader::MeshHandle> & meshes, std::size_t count)
+{
+    auto const & draws = device.Draws();
+    auto const & indirect = device.IndirectCommands();
+    if (draws.size() != MATERIALS || indirect.size() != MATERIALS * meshes.size())
+        return false;
+
+    // The draws read instances from the last range bound to the instance binding
+    const RecordedCommand * binding = nullptr;
+    for (auto const & command : device.Commands())
+        if (command.op == RecordedOp::BindBufferRange && command.target == GL_SHADER_STORAGE_BUFFER && command.index == INSTANCE_BUFFER_BINDING)
+            binding = &command;
+    if (!binding)
+        return false;
+
+    auto const & bytes = device.BufferBytes(binding->object);
+    if (binding->offset + binding->size > static_cast<GLintptr>(bytes.size()))
+        return false;
+    InstanceData const * instances = reinterpret_cast<InstanceData const *>(bytes.data() + binding->offset);
+
+    std::size_t total = 0;
+    for (std::size_t d = 0; d < draws.size(); ++d)
+    {
+        for (std::uint32_t c = 0; c < draws[d].commandCount; ++c)
+        {
+            DrawElementsIndirectCommand const & command = indirect[draws[d].firstCommand + c];
+
+            // Find the mesh this command draws from its index range
+            int mesh = -1;
+            for (std::size_t m = 0; m < meshes.size(); ++m)
+                if (meshes[m].Get().firstIndex == command.firstIndex && static_cast<GLuint>(meshes[m].Get().indexCount) == command.count)
+                    mesh = static_cast<int>(m);
+            if (mesh < 0)
+                return false;
+
+            for (GLuint i = 0; i < command.instanceCount; ++i)
+            {
+                glm::vec4 const & color = instances[command.baseInstance + i].color;
+                if (color.x != static_cast<float>(d) || color.y != static_cast<float>(mesh))
+                    return false;
+            }
+            total += command.instanceCount;
+        }
+    }
+
+    return total == count;
+}
+
+static int framesFor(std::size_t count)
+{
+    return count >= 100000 ? 20 : 200;
+}
+
+static void makeScene(std::size_t count, std::size_t meshCount, std::vector<glm::mat4> & models,
+                      std::vector<std::uint32_t> & materials, std::vector<std::uint32_t> & meshIndex)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+
+    models.resize(count);
+    materials.resize(count);
+    meshIndex.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), position(rng) - 30.0f));
+        materials[i] = rng() % MATERIALS;
+        meshIndex[i] = rng() % meshCount;
+    }
+}
+
+static Result runBatched(std::size_t count, Renderer & renderer, RecordingDevice & device, Camera & camera,
+                         const std::vector<ResourceLoader::MeshHandle> & meshes, const ResourceLoader::ShaderHandle & shader)
+{
+    std::vector<glm::mat4> models;
+    std::vector<std::uint32_t> materials, meshIndex;
+    makeScene(count, meshes.size(), models, materials, meshIndex);
+
+    const int frames = framesFor(count);
+    Result result;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        device.Reset();
+
+        auto start = std::chrono::steady_clock::now();
+        renderer.BeginFrame();
+        renderer.SetCamera(camera);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            glm::vec4 color(static_cast<float>(materials[i]), static_cast<float>(meshIndex[i]), 0.0f, 1.0f);
+            renderer.Submit(meshes[meshIndex[i]], shader, models[i], color, 0, materials[i]);
+        }
+        renderer.Flush();
+        auto end = std::chrono::steady_clock::now();
+
+        result.ms += std::chrono::duration<double, std::milli>(end - start).count();
+        result.ok = result.ok && verify(device, meshes, count);
+    }
+    result.ms /= frames;
+
+    result.draws = device.Draws().size();
+    result.calls = device.Commands().size();
+    result.uniforms = device.Count(RecordedOp::ProgramUniform);
+    result.elided = renderer.Stats().elidedCalls;
+    result.bytes = static_cast<std::size_t>(renderer.Stats().bytesUploaded);
+    return result;
+}
+
+// The pre-batching frame, straight to the device as it went straight to GL.
+// The device has no single draw, so each entity's draw is a one-command
+// multi-draw out of a table holding one command per mesh.
+static Result runPerEntity(std::size_t count, RecordingDevice & device, Camera & camera,
+                           const std::vector<ResourceLoader::MeshHandle> & meshes, const ResourceLoader::ShaderHandle & shader)
+{
+    std::vector<glm::mat4> models;
+    std::vector<std::uint32_t> materials, meshIndex;
+    makeScene(count, meshes.size(), models, materials, meshIndex);
+
+    std::vector<DrawElementsIndirectCommand> table;
+    for (auto const & mesh : meshes)
+        table.push_back({static_cast<GLuint>(mesh.Get().indexCount), 1, mesh.Get().firstIndex, mesh.Get().baseVertex, 0});
+    GLuint commandBuffer = device.CreateBuffer();
+    device.BufferData(commandBuffer, table.size() * sizeof(DrawElementsIndirectCommand), table.data(), GL_STATIC_DRAW);
+
+    const GLuint program = shader.Get().program;
+    const GLint model = 0, view = 1, projection = 2, colorLocation = 3;
+    camera.UpdateMatrices();
+
+    const int frames = framesFor(count);
+    Result result;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        device.Reset();
+
+        auto start = std::chrono::steady_clock::now();
+        device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            glm::vec4 color(static_cast<float>(materials[i]), static_cast<float>(meshIndex[i]), 0.0f, 1.0f);
+            device.UseProgram(program);
+            device.ProgramUniform(program, model, GL_FLOAT_MAT4, glm::value_ptr(models[i]));
+            device.ProgramUniform(program, view, GL_FLOAT_MAT4, glm::value_ptr(camera.view));
+            device.ProgramUniform(program, projection, GL_FLOAT_MAT4, glm::value_ptr(camera.projection));
+            device.ProgramUniform(program, colorLocation, GL_FLOAT_VEC4, glm::value_ptr(color));
+            device.BindVertexArray(meshes[meshIndex[i]].Get().VAO);
+            device.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                             meshIndex[i] * sizeof(DrawElementsIndirectCommand), 1, 0);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        result.ms += std::chrono::duration<double, std::milli>(end - start).count();
+        result.ok = result.ok && device.Draws().size() == count && device.IndirectCommands().size() == count;
+    }
+    result.ms /= frames;
+
+    result.draws = device.Draws().size();
+    result.calls = device.Commands().size();
+    result.uniforms = device.Count(RecordedOp::ProgramUniform);
+    result.bytes = count * (3 * sizeof(glm::mat4) + sizeof(glm::vec4));
+
+    device.DeleteBuffer(commandBuffer);
+    // The replay bypassed GLState, whose shadow no longer matches the device
+    GLState::Invalidate();
+    return result;
+}
+
+int main()
+{
+    RecordingDevice device;
+    RenderDevice::SetCurrent(&device);
+
+    Renderer renderer;
+    renderer.Init();
+
+    float square[] = {
+        0.5f, 0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        -0.5f, -0.5f, 0.0f,
+        -0.5f, 0.5f, 0.0f};
+    unsigned int squareIndices[] = {0, 1, 3, 1, 2, 3};
+
+    float triangle[] = {
+        0.0f, 0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        -0.5f, -0.5f, 0.0f};
+    unsigned int triangleIndices[] = {0, 1, 2};
+
+    std::vector<ResourceLoader::MeshHandle> meshes;
+    meshes.push_back(ResourceLoader::LoadMesh("square", square, sizeof(square), squareIndices, 6));
+    meshes.push_back(ResourceLoader::LoadMesh("triangle", triangle, sizeof(triangle), triangleIndices, 3));
+    ResourceLoader::ShaderHandle shader = ResourceLoader::LoadShader("shaders/vert.glsl", "shaders/frag.glsl");
+
+    Camera camera;
+    camera.LookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.SetPerspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    bool ok = true;
+    for (std::size_t count : {1000u, 10000u, 100000u})
+    {
+        Result before = runPerEntity(count, device, camera, meshes, shader);
+        Result after = runBatched(count, renderer, device, camera, meshes, shader);
+        print("per-entity", count, before);
+        print("batched", count, after);
+        std::printf("%-8zu %-10s draws %.0fx fewer, device calls %.0fx fewer, %.1fx faster\n\n", count, "",
+                    static_cast<double>(before.draws) / after.draws, static_cast<double>(before.calls) / after.calls,
+                    before.ms / after.ms);
+        ok = ok && before.ok && after.ok;
+    }
+
+    meshes.clear();
+    shader = ResourceLoader::ShaderHandle();
+    renderer.Shutdown();
+    ResourceLoader::ReleaseAll();
+    RenderDevice::SetCurrent(nullptr);
+    return ok ? 0 : 1;
+}
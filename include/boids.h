@@ -0,0 +1,67 @@
+#ifndef BOIDS_H
+#define BOIDS_H
+
+#include <vector>
+#include <memory>
+
+#include <glm/ext.hpp>
+
+#include <nomad_entity.hpp>
+#include <spatial_grid.h>
+#include <hierarchy.h>
+
+struct Boid
+{
+    glm::vec3 velocity = glm::vec3(0.0f);
+};
+
+struct BoidSettings
+{
+    float radius = 2.0f;
+    float separation = 1.5f;
+    float alignment = 1.0f;
+    float cohesion = 1.0f;
+    float maxSpeed = 4.0f;
+
+    // Boids wrap around a square of this half size on the XY plane
+    float worldHalfSize = 150.0f;
+};
+
+struct BoidStats
+{
+    double gatherMs = 0.0;
+    double steerMs = 0.0;
+    double writeMs = 0.0;
+    double averageNeighbours = 0.0;
+};
+
+// Classic separation/alignment/cohesion flocking on root entities with
+// Transform and Boid. Neighbours come from a SpatialGridSystem that must be
+// updated first; steering runs in parallel in grid order so neighbouring
+// boids are also neighbours in memory. New positions go through the
+// hierarchy, so run it before HierarchySystem::Propagate.
+class BoidSystem : public System
+{
+    public:
+        void Init(ECS * ecs, std::shared_ptr<SpatialGridSystem> grid, std::shared_ptr<HierarchySystem> hierarchy,
+                  const BoidSettings & settings);
+        void Update(float dt);
+
+        const BoidStats & Stats() const { return stats; }
+
+    private:
+        ECS * ecs = nullptr;
+        std::shared_ptr<SpatialGridSystem> grid;
+        std::shared_ptr<HierarchySystem> hierarchy;
+        BoidSettings settings;
+
+        // Indexed by grid slot
+        std::vector<glm::vec3> velocity;
+        std::vector<glm::vec3> nextVelocity;
+        std::vector<glm::vec3> nextPosition;
+        std::vector<unsigned int> rangeNeighbours;
+
+        BoidStats stats;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <array>
+#include <cfloat>
+
+#include <glm/ext.hpp>
+
+#include <nomad_entity.hpp>
+#include <frustum.h>
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF_SIZE 4
+
+// BVHSystem samples quality after every update that moved, added or removed
+// a primitive. Above the partial ratio, subtrees whose area grew past
+// BVH_NODE_GROWTH_RATIO are rebuilt; above the full ratio the whole tree is.
+#define BVH_PARTIAL_REBUILD_RATIO 1.25f
+#define BVH_FULL_REBUILD_RATIO 2.0f
+#define BVH_NODE_GROWTH_RATIO 2.0f
+// BVHSystem rebuilds instead of inserting once more entities than this share
+// of the tree joined since the last update
+#define BVH_REBUILD_ADD_RATIO 0.25f
+
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void Grow(const glm::vec3 & point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Grow(const AABB & box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    // Holds nothing; a default AABB is empty
+    bool Empty() const { return min.x > max.x; }
+
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+    float SurfaceArea() const
+    {
+        glm::vec3 d = max - min;
+        return d.x < 0.0f ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool Overlaps(const AABB & box) const
+    {
+        return min.x <= box.max.x && max.x >= box.min.x &&
+               min.y <= box.max.y && max.y >= box.min.y &&
+               min.z <= box.max.z && max.z >= box.min.z;
+    }
+
+    bool operator==(const AABB & box) const { return min == box.min && max == box.max; }
+    bool operator!=(const AABB & box) const { return !(*this == box); }
+};
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+};
+
+struct BVHStats
+{
+    unsigned int nodes = 0;
+    unsigned int refitNodes = 0;
+    unsigned int partialRebuilds = 0;
+    unsigned int fullRebuilds = 0;
+    unsigned int inserts = 0;
+    unsigned int removals = 0;
+    float cost = 0.0f;
+    float buildCost = 0.0f;
+};
+
+// Bounding volume hierarchy over primitive AABBs, built top-down with binned
+// SAH. Moving primitives refit their leaf and walk up until a parent stops
+// changing. Remove frees the primitive's slot in its leaf. Insert walks down
+// to the leaf that grows least and takes a free slot there, or splits the
+// leaf when it is full. Neither keeps the topology optimal, so quality
+// degrades over time; Optimize() rebuilds the subtrees that grew the most
+// and falls back to a full build once the tree is too far off its
+// build-time cost or half its slots are free.
+class BVH
+{
+    public:
+        // Primitive i gets boxes[i]; empty boxes leave their id free
+        void Build(const std::vector<AABB> & boxes);
+        // Returns the new primitive's id, reusing removed ones first
+        int Insert(const AABB & box);
+        void Remove(int prim);
+        void Refit(std::size_t prim, const AABB & box);
+        void Optimize();
+
+        // SAH cost of the current tree, relative to its root area
+        float Cost() const;
+
+        void QueryFrustum(const Frustum & frustum, std::vector<int> & out) const;
+        void QueryAABB(const AABB & box, std::vector<int> & out) const;
+
+        // Nearest primitive box hit along the ray within maxDistance
+        bool Raycast(const Ray & ray, float maxDistance, int & prim, float & distance) const;
+
+        // Primitives in the tree
+        std::size_t Size() const { return live; }
+        const AABB & PrimBounds(std::size_t prim) const { return primBounds[prim]; }
+        const BVHStats & Stats() const { return stats; }
+
+    private:
+        // Leaves have left == -1 and own the slots
+        // primIndices[first, first + count), where free slots hold -1
+        // (internal nodes' ranges are only meaningful while building)
+        struct Node
+        {
+            AABB bounds;
+            int first = 0;
+            int count = 0;
+            int left = -1;
+            int right = -1;
+            int parent = -1;
+            float buildArea = 0.0f;
+        };
+
+        void buildNode(int node, int first, int count);
+        void partialRebuild(int node);
+        void killSubtree(int node);
+        void refitUp(int node);
+        // Returns the new empty leaf
+        int splitLeaf(int leaf);
+        // Appends the primitives under node to out
+        void collectPrims(int node, std::vector<int> & out) const;
+        AABB rangeBounds(int first, int count) const;
+
+        std::vector<Node> nodes;
+        std::vector<int> primIndices;
+        std::vector<int> primLeaf;
+        std::vector<AABB> primBounds;
+        std::vector<int> freePrims;
+
+        std::size_t live = 0;
+        std::size_t deadNodes = 0;
+        BVHStats stats;
+};
+
+// Keeps a BVH over every entity with Transform and Bounds. Entities leaving
+// are removed from the tree as they go; Update() inserts the ones that joined,
+// refits those whose world bounds changed since it last ran and, if anything
+// changed, checks the tree's quality. Nothing happens per step, so call
+// Update() before querying.
+class BVHSystem : public System
+{
+    public:
+        void Init(ECS * ecs);
+        void Update();
+
+        void entityAdded(Entity entity) override;
+        void entityRemoved(Entity entity) override;
+
+        void QueryFrustum(const Frustum & frustum, std::vector<Entity> & out) const;
+        void QueryAABB(const AABB & box, std::vector<Entity> & out) const;
+        bool Raycast(const Ray & ray, float maxDistance, Entity & entity, float & distance) const;
+
+        const BVH & Tree() const { return tree; }
+
+    private:
+        AABB worldBox(Entity entity);
+
+        ECS * ecs = nullptr;
+        BVH tree;
+
+        // Primitive of every entity id, or -1
+        std::vector<int> entityPrim;
+        // Entity of every primitive id, or -1
+        std::vector<int> primEntity;
+        // Joined since the last Update
+        std::vector<Entity> added;
+        bool rebuild = true;
+        std::vector<AABB> boxes;
+        mutable std::vector<int> hits;
+        // Set when the tree changed since quality was last sampled
+        bool changed = false;
+};
+
+#endif
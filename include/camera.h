@@ -0,0 +1,83 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <cstdint>
+
+#include <glm/ext.hpp>
+
+#include <frustum.h>
+
+// Uniform block binding point shared by every shader that reads the camera
+#define CAMERA_UBO_BINDING 0
+
+// Mirrors the std140 CameraBlock declared in the shaders
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 position;
+    glm::vec4 frustumPlanes[6];
+};
+
+// Camera component. View and projection are only rebuilt after one of the
+// setters has changed something; version increments whenever they are, so
+// consumers can tell when to re-upload.
+struct Camera
+{
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 3.0f);
+    glm::vec3 target = glm::vec3(0.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float fovy = glm::radians(45.0f);
+    float aspect = 16.0f / 9.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+
+    void LookAt(const glm::vec3 & eye, const glm::vec3 & center, const glm::vec3 & upVector)
+    {
+        position = eye;
+        target = center;
+        up = upVector;
+        viewDirty = true;
+    }
+
+    void SetPerspective(float fovyRadians, float aspectRatio, float zNear, float zFar)
+    {
+        fovy = fovyRadians;
+        aspect = aspectRatio;
+        nearPlane = zNear;
+        farPlane = zFar;
+        projectionDirty = true;
+    }
+
+    // Rebuilds whichever matrices are stale; returns true if anything changed
+    bool UpdateMatrices()
+    {
+        if (!viewDirty && !projectionDirty)
+            return false;
+
+        if (viewDirty)
+            view = glm::lookAt(position, target, up);
+        if (projectionDirty)
+            projection = glm::perspective(fovy, aspect, nearPlane, farPlane);
+
+        viewProjection = projection * view;
+        frustum = Frustum::FromMatrix(viewProjection);
+        viewDirty = false;
+        projectionDirty = false;
+        ++version;
+        return true;
+    }
+
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    Frustum frustum{};
+    std::uint32_t version = 0;
+
+    bool viewDirty = true;
+    bool projectionDirty = true;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/ext.hpp>
+
+#include <nomad_entity.hpp>
+#include <frustum.h>
+
+// Local-space bounds. A sphere uses radius with zero extents, a box uses
+// half extents with zero radius; the culler handles both with one test.
+struct Bounds
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 extents = glm::vec3(0.0f);
+
+    static Bounds Sphere(const glm::vec3 & center, float radius)
+    {
+        return Bounds{center, radius, glm::vec3(0.0f)};
+    }
+
+    static Bounds Box(const glm::vec3 & center, const glm::vec3 & halfExtents)
+    {
+        return Bounds{center, 0.0f, halfExtents};
+    }
+};
+
+// Transforms local bounds by a world matrix. The radius follows the largest
+// axis scale; box extents grow to the world AABB of the rotated box.
+void TransformBounds(const glm::mat4 & world, const Bounds & local, glm::vec3 & center, float & radius, glm::vec3 & extents);
+
+// World-space bounds in structure-of-arrays layout, one lane per entity
+struct BoundsSoA
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> radius;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void Resize(std::size_t count);
+    void Set(std::size_t i, const glm::vec3 & center, float r, const glm::vec3 & extents);
+    std::size_t Size() const { return radius.size(); }
+};
+
+namespace Culling
+{
+    enum class Kernel
+    {
+        Scalar,
+        SSE,
+        AVX
+    };
+
+    // Widest kernel this CPU supports
+    Kernel BestKernel();
+    const char * KernelName(Kernel kernel);
+
+    // Writes 1/0 per lane into visible and returns the number of visible
+    // lanes. AVX tests 8 bounds per iteration against all six planes, SSE 4.
+    std::size_t CullBounds(const Frustum & frustum, const BoundsSoA & bounds, std::uint8_t * visible, Kernel kernel);
+}
+
+struct CullingStats
+{
+    unsigned int tested = 0;
+    unsigned int visible = 0;
+    unsigned int culled = 0;
+    double gatherMs = 0.0;
+    double testMs = 0.0;
+};
+
+// Culls every entity with Transform and Bounds against a frustum each frame.
+// Results are a per-entity visible flag and a list of visible entities.
+class CullingSystem : public System
+{
+    public:
+        void Init(ECS * ecs);
+        void Update(const Frustum & frustum);
+
+        bool IsVisible(Entity entity) const { return entityVisible[entity.id()] != 0; }
+        const std::vector<Entity> & Visible() const { return visible; }
+        const CullingStats & Stats() const { return stats; }
+
+    private:
+        ECS * ecs = nullptr;
+        Culling::Kernel kernel = Culling::Kernel::Scalar;
+
+        BoundsSoA worldBounds;
+        std::vector<int> laneEntity;
+        std::vector<std::uint8_t> laneVisible;
+        std::vector<std::uint8_t> entityVisible;
+        std::vector<Entity> visible;
+
+        CullingStats stats;
+};
+
+#endif
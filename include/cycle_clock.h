@@ -0,0 +1,36 @@
+#ifndef CYCLE_CLOCK_H
+#define CYCLE_CLOCK_H
+
+#include <cstdint>
+#include <chrono>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define CYCLE_CLOCK_TSC
+#endif
+
+// Cheapest monotonic timestamp available, for stamping events on hot paths.
+// On x86 this is the time stamp counter, which modern CPUs run at a constant
+// rate shared by all cores; elsewhere it is steady_clock in nanoseconds.
+// Ticks are converted to time only when events are read back.
+namespace CycleClock
+{
+    inline std::uint64_t Now()
+    {
+#ifdef CYCLE_CLOCK_TSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Calibrated against steady_clock on the first call, which takes ~10 ms
+    double NanosecondsPerTick();
+
+    inline double ToNanoseconds(std::uint64_t ticks)
+    {
+        return static_cast<double>(ticks) * NanosecondsPerTick();
+    }
+}
+
+#endif
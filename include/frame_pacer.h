@@ -0,0 +1,75 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <cstdint>
+
+// A frame counts as late when its interval exceeds the target period by
+// more than this fraction of it
+#define FRAME_PACER_LATE_TOLERANCE 0.1
+
+struct FramePacerStats
+{
+    std::uint64_t frames = 0;
+    double targetMs = 0.0;
+    double meanMs = 0.0;
+    // Standard deviation of the frame interval
+    double jitterMs = 0.0;
+    // Largest distance of one interval from the target period
+    double maxDeviationMs = 0.0;
+    std::uint64_t lateFrames = 0;
+    // Current estimate of how long a 1 ms sleep really takes
+    double sleepEstimateMs = 0.0;
+};
+
+// Holds the loop to a target frame rate on 64-bit steady_clock time.
+// Deadlines advance by exactly one period, so rounding never accumulates
+// into drift; a loop more than a period behind restarts from now instead of
+// rushing to catch up.
+//
+// Waiting sleeps in 1 ms slices while the remaining time exceeds what such a
+// sleep has been observed to take, then spins for the rest. The estimate
+// adapts to the platform's timer granularity, so deadlines are met to well
+// under a millisecond without spinning the whole frame.
+class FramePacer
+{
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // 0 disables waiting; frames then run back to back
+        void SetTargetRate(double hz);
+        double TargetRate() const { return targetRate; }
+
+        // Restarts the clock; the next BeginFrame measures from here
+        void Reset();
+
+        // Seconds since the previous BeginFrame or Reset
+        double BeginFrame();
+        // Returns once the current frame's deadline has passed
+        void Wait();
+
+        FramePacerStats Stats() const;
+        void ResetStats();
+
+    private:
+        void sleepUntil(Clock::time_point deadline);
+        void observeSleep(double ms);
+
+        double targetRate = 0.0;
+        Clock::duration period = Clock::duration::zero();
+        Clock::time_point lastFrame;
+        Clock::time_point deadline;
+
+        // Running frame interval statistics (Welford)
+        std::uint64_t frames = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+        double maxDeviation = 0.0;
+        std::uint64_t lateFrames = 0;
+
+        // Exponentially weighted mean and variance of 1 ms sleeps
+        double sleepMean = 1.0;
+        double sleepVariance = 0.0;
+};
+
+#endif
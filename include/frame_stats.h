@@ -0,0 +1,193 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <cycle_clock.h>
+
+// Linear buckets per power of two; 8 bits keeps every bucket within 0.8% of
+// the values it holds
+#define FRAME_HISTOGRAM_SUB_BITS 8
+// Longest time told apart, in microseconds (~67 s); longer ones share the
+// last bucket
+#define FRAME_HISTOGRAM_MAX_BITS 26
+
+#define FRAME_STATS_WINDOW_SECONDS 1.0
+// Completed windows kept for export; older ones are overwritten
+#define FRAME_STATS_MAX_WINDOWS 600
+// A frame is a hitch when it takes this many times its budget
+#define FRAME_STATS_HITCH_FACTOR 2.0
+
+// Fixed-size log-linear histogram of durations in the style of HdrHistogram.
+// Below 2^SUB_BITS microseconds every value has its own bucket; above, each
+// power of two is split into 2^(SUB_BITS - 1) equal buckets. Recording is an
+// index computation and an increment, and never allocates.
+class FrameHistogram
+{
+    public:
+        static constexpr std::size_t SUB_COUNT = std::size_t(1) << FRAME_HISTOGRAM_SUB_BITS;
+        static constexpr std::size_t HALF_COUNT = SUB_COUNT / 2;
+        static constexpr std::size_t BUCKETS =
+            SUB_COUNT + (FRAME_HISTOGRAM_MAX_BITS - FRAME_HISTOGRAM_SUB_BITS) * HALF_COUNT;
+
+        void Record(double ms);
+        void Merge(const FrameHistogram & other);
+        void Reset();
+
+        std::uint64_t Count() const { return count; }
+        double MeanMs() const { return count ? sumMs / count : 0.0; }
+        double MaxMs() const { return maxMs; }
+        // Smallest recorded bucket bound that p percent of values are at or
+        // below, capped at the exact maximum
+        double PercentileMs(double p) const;
+
+    private:
+        static std::size_t bucketOf(std::uint64_t us);
+        static std::uint64_t upperBound(std::size_t bucket);
+
+        std::uint32_t buckets[BUCKETS] = {};
+        std::uint64_t count = 0;
+        double sumMs = 0.0;
+        double maxMs = 0.0;
+};
+
+struct FrameTimeSummary
+{
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Work the renderer did in one frame, see RenderStats, and what CPU culling
+// decided; see CullingStats
+struct FrameRenderCounts
+{
+    std::uint64_t drawCalls = 0;
+    std::uint64_t instances = 0;
+    std::uint64_t triangles = 0;
+    std::uint64_t programBinds = 0;
+    std::uint64_t vaoBinds = 0;
+    std::uint64_t textureBinds = 0;
+    std::uint64_t bufferBinds = 0;
+    std::uint64_t elidedCalls = 0;
+    std::uint64_t uniformUploads = 0;
+    std::uint64_t bytesUploaded = 0;
+    std::uint64_t cullVisible = 0;
+    std::uint64_t cullCulled = 0;
+    std::uint64_t cullGatherUs = 0;
+    std::uint64_t cullTestUs = 0;
+};
+
+struct FrameStatsWindow
+{
+    // Seconds of recorded frame time before the window opened
+    double startSeconds = 0.0;
+    double seconds = 0.0;
+    std::uint64_t frames = 0;
+    // Simulation steps run across those frames
+    std::uint64_t steps = 0;
+    std::uint64_t hitches = 0;
+    // Whole frame interval; update is every step the frame ran, render is
+    // submission through the buffer swap
+    FrameTimeSummary frame;
+    FrameTimeSummary update;
+    FrameTimeSummary render;
+    // Summed over the frames; per-frame means are these divided by frames
+    FrameRenderCounts renderTotal;
+    FrameRenderCounts renderMax;
+};
+
+// Collects per-frame timings for the whole session and for consecutive
+// windows of FRAME_STATS_WINDOW_SECONDS. Each closed window is reduced to
+// percentiles and kept in a ring, so a long session costs a fixed amount of
+// memory. All storage is allocated by Init; RecordFrame only writes into it.
+class FrameStats
+{
+    public:
+        void Init(double window_seconds = FRAME_STATS_WINDOW_SECONDS,
+                  std::size_t max_windows = FRAME_STATS_MAX_WINDOWS);
+        void Reset();
+
+        // Frames longer than this are counted as hitches; 0 counts none
+        void SetHitchThreshold(double ms) { hitchMs = ms; }
+
+        void RecordFrame(double frame_ms, double update_ms, double render_ms, int steps,
+                         const FrameRenderCounts & counts = FrameRenderCounts{});
+
+        // Splits frames between named systems. BeginSystems starts a lap and
+        // Lap(system) charges the time since the last one to system; the laps
+        // taken before RecordFrame make up that frame's costs. Kept for the
+        // session only.
+        int AddSystem(const char * name);
+        void BeginSystems() { lapStart = CycleClock::Now(); }
+        void Lap(int system)
+        {
+            std::uint64_t now = CycleClock::Now();
+            systems[system].pendingTicks += now - lapStart;
+            lapStart = now;
+        }
+
+        std::size_t SystemCount() const { return systems.size(); }
+        const char * SystemName(std::size_t index) const { return systems[index].name; }
+        FrameTimeSummary SystemSession(std::size_t index) const;
+
+        // Everything recorded since Init or Reset
+        FrameStatsWindow Session() const;
+        // Closed windows, oldest first
+        std::size_t WindowCount() const { return windowCount; }
+        const FrameStatsWindow & Window(std::size_t index) const;
+
+        // Writes the windows, a session row and the system costs. A path
+        // ending in ".json" gets JSON, anything else CSV. Returns false if
+        // the file could not be written.
+        bool Dump(const std::string & path) const;
+
+    private:
+        struct Series
+        {
+            FrameHistogram frame;
+            FrameHistogram update;
+            FrameHistogram render;
+            std::uint64_t steps = 0;
+            std::uint64_t hitches = 0;
+            double seconds = 0.0;
+            FrameRenderCounts renderTotal;
+            FrameRenderCounts renderMax;
+
+            void Reset();
+            FrameStatsWindow Summarize(double start_seconds) const;
+        };
+
+        struct SystemSeries
+        {
+            const char * name;
+            FrameHistogram ms;
+            std::uint64_t pendingTicks = 0;
+        };
+
+        void closeWindow();
+        bool dumpCSV(std::FILE * file) const;
+        bool dumpJSON(std::FILE * file) const;
+
+        double windowSeconds = FRAME_STATS_WINDOW_SECONDS;
+        double hitchMs = 0.0;
+
+        Series session;
+        Series current;
+        double currentStart = 0.0;
+
+        std::vector<FrameStatsWindow> windows;
+        std::size_t windowHead = 0;
+        std::size_t windowCount = 0;
+
+        std::vector<SystemSeries> systems;
+        std::uint64_t lapStart = 0;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/ext.hpp>
+
+// Six normalized planes (left, right, bottom, top, near, far) with normals
+// pointing inwards, so a point p is inside when dot(n, p) + d >= 0 for all.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction from a view-projection matrix
+    static Frustum FromMatrix(const glm::mat4 & m)
+    {
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0;
+        frustum.planes[1] = row3 - row0;
+        frustum.planes[2] = row3 + row1;
+        frustum.planes[3] = row3 - row1;
+        frustum.planes[4] = row3 + row2;
+        frustum.planes[5] = row3 - row2;
+
+        for (auto & plane : frustum.planes)
+        {
+            float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+            plane = plane * (1.0f / length);
+        }
+        return frustum;
+    }
+
+    // Scalar reference test, also used to cross-check the GPU and SIMD cullers
+    bool IntersectsSphere(const glm::vec3 & center, float radius) const
+    {
+        for (auto const & plane : planes)
+        {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
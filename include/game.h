@@ -2,6 +2,8 @@
 #define GAME_H
 
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include <SDL2/SDL.h>
 #include <glad/glad.h>
@@ -9,6 +11,16 @@
 
 #include <resource_loader.h>
 #include <nomad_entity.hpp>
+#include <hierarchy.h>
+#include <renderer.h>
+#include <culling.h>
+#include <bvh.h>
+#include <boids.h>
+#include <game_config.h>
+#include <frame_pacer.h>
+#include <frame_stats.h>
+#include <input_recorder.h>
+#include <recording_device.h>
 
 #define WINDOW_TITLE ""
 #define WINDOW_POS SDL_WINDOWPOS_CENTERED
@@ -16,52 +28,136 @@
 #define WINDOW_HEIGHT 720
 #define WINDOW_ARGS SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL
 
-#define MAX_FRAMERATE 120
-
 #define MAX_KEYS_LENGTH 322
 
+// Colour a left click gives the entity under the cursor
+#define PICK_COLOR glm::vec4(1.0f, 1.0f, 0.0f, 1.0f)
+
+// Frames run before a benchmark starts measuring
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_SEED 1234
+// Share of the churn scene replaced every frame
+#define BENCH_CHURN_RATE 0.01f
+// Nodes per chain in the hierarchy scene
+#define BENCH_HIERARCHY_DEPTH 32
+
 class Game
 {
     public:
         static Game & Instance();
-        void Run();
+        void Run(const GameConfig & config = GameConfig{});
         void Close();
+        // Non-zero when a check the config asked for failed
+        int ExitCode() const { return cullMismatches > 0 ? 1 : 0; }
 
         Game(const Game&) = delete;
         Game& operator=(const Game&) = delete;
 
         void SetClearColor(glm::vec4 color);
         void SetWindowTitle(const char * window_title);
+        // 0 off, 1 vsync, -1 adaptive vsync (falls back to vsync where the
+        // driver lacks it). Returns false if nothing could be set.
+        bool SetSwapInterval(int interval);
+
+        // Nearest entity with Bounds under a window pixel, or Entity(-1).
+        // Brings the BVH up to date first.
+        Entity Pick(int x, int y);
 
         bool Running;
         bool Keys[MAX_KEYS_LENGTH];
+        // Fixed simulation step, in seconds
         float DeltaTime;
+        // How far rendering is between the previous and the current step
+        float Alpha = 0.0f;
         SDL_Event Event;
     private:
         Game() = default;
+
+        // Systems frame costs are split between; see FrameStats::Lap
+        enum SystemLap
+        {
+            LAP_SCENE,
+            LAP_INPUT,
+            LAP_HIERARCHY,
+            LAP_GRID,
+            LAP_BOIDS,
+            LAP_CULLING,
+            LAP_SUBMIT,
+            LAP_FLUSH,
+            LAP_PRESENT,
+            LAP_COUNT
+        };
+
         // init functions
         bool initSDL();
         void initWindowHints();
         bool createWindow();
         bool createGLContext();
         bool initGLAD();
+        bool initDisplay();
         bool init();
 
         void createSquare(Entity entity);
-        float calculateDeltaTime(unsigned int NOW, unsigned int & LAST);
 
         void pollEvents();
         void pollKeys();
+        // Sets Keys from a live or replayed event
+        void applyInput(const InputEvent & event);
+        // One fixed simulation step
         void update();
 
         void render();
 
-        SDL_Window * window;
-        SDL_GLContext ctx;
+        // Accumulates frame time and runs as many steps as it covers, up to
+        // maxStepsPerFrame, then renders interpolated by the remainder
+        void runWindowed();
+        // Steps update() back to back with no pacing and reports the
+        // achieved tick rate
+        void runHeadless();
+        // Logs the session's frame statistics and writes the reports
+        void reportStats();
+        // Writes frame statistics and the trace to whichever paths are set
+        void writeReports();
+
+        // Runs config.benchScene one step per frame through update() and,
+        // unless headless, render()
+        void runBench();
+        bool setupBench();
+        // Scripted changes the scene makes every frame before update()
+        void stepBench();
+        Entity spawnBenchSquare(const glm::vec3 & position);
+
+        GameConfig config;
+        FramePacer pacer;
+        FrameStats frameStats;
+        SDL_Window * window = nullptr;
+        SDL_GLContext ctx = nullptr;
+        // Takes asset and state calls in headless mode, where there is no context
+        RecordingDevice nullDevice;
         ECS ecs;
-
-        glm::mat4 view, projection;
+        std::shared_ptr<HierarchySystem> hierarchy;
+        std::shared_ptr<CullingSystem> culling;
+        std::shared_ptr<BVHSystem> spatial;
+        std::shared_ptr<SpatialGridSystem> grid;
+        std::shared_ptr<BoidSystem> boids;
+        Renderer renderer;
+        // Commands GPU culling got wrong, under config.cullCrossCheck
+        std::uint64_t cullMismatches = 0;
+
+        // Steps run so far; recorded input is keyed by it
+        std::uint64_t stepIndex = 0;
+        InputRecorder inputRecorder;
+        InputReplay inputReplay;
+
+        Entity camera = Entity(-1);
         glm::vec4 clearColor;
+
+        // Benchmark scene state: its entities, their rest positions and the
+        // generator every random choice comes from
+        std::vector<Entity> benchEntities;
+        std::vector<glm::vec3> benchOrigins;
+        std::mt19937 benchRng{BENCH_SEED};
+        std::uint64_t benchFrame = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef GAME_CONFIG_H
+#define GAME_CONFIG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <profiler.h>
+
+#define DEFAULT_TICK_RATE 60.0f
+#define DEFAULT_FRAME_RATE 120.0f
+#define DEFAULT_MAX_STEPS_PER_FRAME 8
+#define DEFAULT_BENCH_FRAMES 600
+
+// Startup options for Game::Run, parsed from the command line or filled in
+// directly by an embedding program
+struct GameConfig
+{
+    // No window, GL context or rendering. Systems step without waiting, as
+    // fast as the CPU allows.
+    bool headless = false;
+    // No window; frames are rendered into a RecordingDevice, so the whole
+    // renderer runs without a GPU
+    bool recordingDevice = false;
+    // Simulation steps per second; every step advances by 1 / tickRate
+    float tickRate = DEFAULT_TICK_RATE;
+    // Render rate cap held by the frame pacer; 0 renders as fast as possible
+    float frameRate = DEFAULT_FRAME_RATE;
+    // Who decides which Bounds entities are drawn. By default CullingSystem
+    // tests them on the CPU and only the visible ones are submitted. With
+    // gpuCulling all are submitted and the renderer's compute pass culls
+    // them instead; devices that do not execute work fall back to the CPU.
+    bool gpuCulling = false;
+    // Checks the GPU-culled counts of every frame against a CPU reference
+    // and fails the run on any mismatch. Stalls each frame on the readback;
+    // for testing. Implies gpuCulling.
+    bool cullCrossCheck = false;
+    // SDL swap interval: 0 off, 1 vsync, -1 adaptive vsync
+    int swapInterval = 0;
+    // Steps one frame may run to catch up. Time beyond that is dropped, so
+    // a slow frame cannot snowball into ever longer ones.
+    int maxStepsPerFrame = DEFAULT_MAX_STEPS_PER_FRAME;
+    // Quit after this many frames, or steps when headless; 0 runs until quit
+    std::uint64_t maxTicks = 0;
+    // Frame statistics are written here at exit and on SIGUSR1; ".json"
+    // selects JSON, anything else CSV. Empty only logs the session summary.
+    std::string statsPath;
+    // Chrome trace of the last traceFrames frames, written at exit and on
+    // SIGUSR1. Zones are only recorded in NOMAD_PROFILE builds.
+    std::string tracePath;
+    std::size_t traceFrames = PROFILER_EXPORT_FRAMES;
+
+    // Runs a benchmark scene instead of the game: squares, boids, churn or
+    // hierarchy. Every frame is one step with no pacing; maxTicks frames
+    // (DEFAULT_BENCH_FRAMES when 0) are measured after a short warmup.
+    std::string benchScene;
+    // Entities in the scene; 0 picks the scene's default
+    std::size_t benchEntities = 0;
+
+    // Key input of every step is written here. Replaying it runs the same
+    // steps with the same input, and stops after the last recorded step;
+    // the recorded tick rate replaces tickRate.
+    std::string recordPath;
+    std::string replayPath;
+
+    // Recognises --headless, --recording-device, --gpu-culling,
+    // --cull-cross-check, --tick-rate <hz>, --frame-rate <hz>,
+    // --vsync off|on|adaptive, --max-steps <n>, --ticks <n> (or --frames <n>),
+    // --stats <path>, --trace <path>, --trace-frames <n>, --bench <scene>,
+    // --bench-entities <n>, --record <path> and --replay <path>.
+    // Setting NOMAD_HEADLESS=1 in the environment also selects headless
+    // mode, and NOMAD_STATS and NOMAD_TRACE the output paths.
+    static GameConfig FromArgs(int argc, char * argv[]);
+};
+
+#endif
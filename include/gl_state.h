@@ -0,0 +1,46 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Thin shadow of the GL binding and enable state. Engine code calls these
+// instead of the raw glad functions; a call that would not change the
+// current state is dropped and the rest go to RenderDevice::Current().
+// Deleting objects must also go through here so the shadow never refers to a
+// recycled name.
+namespace GLState
+{
+    struct Counters
+    {
+        unsigned int issued = 0;
+        unsigned int elided = 0;
+        // Issued calls by kind; the indexed buffer binds count as buffer binds
+        unsigned int programBinds = 0;
+        unsigned int vaoBinds = 0;
+        unsigned int bufferBinds = 0;
+        unsigned int textureBinds = 0;
+    };
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void ActiveTexture(GLenum unit);
+    void BindTexture(GLenum target, GLuint texture);
+    void Enable(GLenum capability);
+    void Disable(GLenum capability);
+
+    void DeleteProgram(GLuint program);
+    void DeleteVertexArrays(GLsizei count, const GLuint * vaos);
+    void DeleteBuffers(GLsizei count, const GLuint * buffers);
+    void DeleteTextures(GLsizei count, const GLuint * textures);
+
+    // Forget everything, e.g. after code outside the engine touched GL
+    void Invalidate();
+
+    const Counters & FrameCounters();
+    void ResetFrameCounters();
+}
+
+#endif
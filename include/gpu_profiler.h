@@ -0,0 +1,106 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <profiler.h>
+
+// Frames of queries in flight. A frame's results are read when its slot
+// comes round again, by which time the GPU has normally finished it.
+#define GPU_PROFILER_FRAMES 4
+// Zones per frame; further ones in the same frame are not timed
+#define GPU_PROFILER_ZONES 32
+
+#if NOMAD_PROFILE
+// Times the GPU work issued in the rest of the enclosing scope
+#define GPU_PROFILE_SCOPE(profiler, name) GpuZone PROFILE_CONCAT(gpu_zone_, __LINE__)(profiler, name)
+#else
+#define GPU_PROFILE_SCOPE(profiler, name)
+#endif
+
+struct GpuZoneTiming
+{
+    const char * name;
+    double ms;
+};
+
+// Times GPU work with pairs of GL_TIMESTAMP queries taken through the
+// current RenderDevice. Timestamps rather than GL_TIME_ELAPSED let zones
+// nest, and place them on the GPU clock. That clock is matched to CycleClock
+// once per frame, so the zones land on a "GPU" track of the CPU profiler's
+// trace.
+//
+// Queries come from a ring GPU_PROFILER_FRAMES frames deep. A frame whose
+// results are still not available when its slot is reused is dropped
+// rather than waited for, so timing never stalls the pipeline.
+//
+// Does nothing in builds without NOMAD_PROFILE.
+class GpuProfiler
+{
+    public:
+        void Init();
+        void Shutdown();
+
+        // Reads back the frame issued GPU_PROFILER_FRAMES - 1 frames ago and
+        // starts recording into its slot
+        void BeginFrame();
+
+        // name must be a string literal. Zones nest; End closes the innermost.
+        void Begin(const char * name);
+        void End();
+
+        // Zones of the newest frame read back, in the order they began
+        const std::vector<GpuZoneTiming> & Results() const { return results; }
+        // Frames given up on because the GPU had not finished them in time
+        std::uint64_t DroppedFrames() const { return droppedFrames; }
+
+    private:
+        struct Zone
+        {
+            const char * name;
+            GLuint begin;
+            GLuint end;
+        };
+
+        struct Frame
+        {
+            Zone zones[GPU_PROFILER_ZONES];
+            int count = 0;
+        };
+
+        void readBack(Frame & frame);
+
+        bool enabled = false;
+        std::vector<GLuint> queries;
+        Frame frames[GPU_PROFILER_FRAMES];
+        int current = 0;
+
+        int open[GPU_PROFILER_ZONES];
+        int depth = 0;
+
+        // GPU clock and CycleClock read at the same moment
+        GLint64 gpuSync = 0;
+        std::uint64_t cpuSync = 0;
+
+        std::vector<GpuZoneTiming> results;
+        std::uint64_t droppedFrames = 0;
+        ProfileRing * track = nullptr;
+};
+
+class GpuZone
+{
+    public:
+        GpuZone(GpuProfiler & profiler, const char * name) : profiler(profiler) { profiler.Begin(name); }
+        ~GpuZone() { profiler.End(); }
+
+        GpuZone(const GpuZone &) = delete;
+        GpuZone & operator=(const GpuZone &) = delete;
+
+    private:
+        GpuProfiler & profiler;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include <glm/ext.hpp>
+
+#include <nomad_entity.hpp>
+
+struct Transform
+{
+    glm::mat4 local = glm::mat4(1.0f);
+    glm::mat4 world = glm::mat4(1.0f);
+    // World matrix as of the previous simulation step
+    glm::mat4 previous = glm::mat4(1.0f);
+
+    // World matrix alpha of the way from the previous step to the current
+    // one. Blended per component: exact for translation and scale, close
+    // enough for the small rotation of a single step.
+    glm::mat4 Interpolated(float alpha) const
+    {
+        glm::mat4 result;
+        for (int i = 0; i < 4; ++i)
+            result[i] = previous[i] + (world[i] - previous[i]) * alpha;
+        return result;
+    }
+};
+
+// Entity(-1) means the entity is a root
+struct Parent
+{
+    Entity entity = Entity(-1);
+};
+
+struct Children
+{
+    std::vector<Entity> entities;
+};
+
+// Keeps every Transform entity in a breadth-first (depth-sorted) node list so
+// parents always come before their children. Propagate() is then a single
+// linear pass that only recomputes world matrices under dirty nodes. The list
+// is rebuilt after any Transform entity is created, destroyed or reparented.
+//
+// Propagate() is meant to run once per simulation step. It also keeps
+// Transform::previous: nodes that moved last step catch up to their world
+// matrix first, and nodes new to the hierarchy start out not moving.
+class HierarchySystem : public System
+{
+    public:
+        void Init(ECS * ecs);
+
+        // Returns false, changing nothing, if parent is child or one of its
+        // descendants
+        bool Attach(Entity child, Entity parent);
+        void Detach(Entity child);
+
+        void SetLocal(Entity entity, const glm::mat4 & local);
+        const glm::mat4 & GetLocal(Entity entity);
+        const glm::mat4 & GetWorld(Entity entity);
+
+        // Destroys entity and all of its descendants in one batch
+        void DestroySubtree(Entity root);
+
+        void Propagate();
+
+        void entityAdded(Entity entity) override;
+        void entityRemoved(Entity entity) override;
+
+        std::size_t NodeCount() const { return nodeEntity.size(); }
+        std::size_t UpdatedLastPropagate() const { return updatedCount; }
+
+    private:
+        void rebuildOrder();
+        void removeFromParent(Entity child);
+        int slotOf(Entity entity);
+
+        ECS * ecs = nullptr;
+
+        // Node data in depth order, indexed by slot
+        std::vector<int> nodeEntity;
+        std::vector<int> nodeParent;
+        std::vector<glm::mat4> nodeLocal;
+        std::vector<glm::mat4> nodeWorld;
+        std::vector<std::uint8_t> nodeDirty;
+        // Set until the node's first world matrix has been computed
+        std::vector<std::uint8_t> nodeFresh;
+
+        // Entities whose world matrix changed in the last Propagate
+        std::vector<int> moved;
+
+        std::array<int, MAX_ENTITIES> entityToSlot{};
+
+        bool orderDirty = true;
+        std::size_t dirtyCount = 0;
+        std::size_t updatedCount = 0;
+};
+
+#endif
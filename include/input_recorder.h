@@ -0,0 +1,91 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Recorded bytes buffered before they are written out
+#define INPUT_RECORDER_FLUSH_BYTES (64 * 1024)
+
+enum class InputEventType : std::uint8_t
+{
+    KeyDown,
+    KeyUp,
+    // Closes a stream; its step is the number of steps recorded
+    End
+};
+
+struct InputEvent
+{
+    // Fixed step the event takes effect before
+    std::uint64_t step;
+    // SDL event timestamp, in milliseconds
+    std::uint32_t timestamp;
+    InputEventType type;
+    std::int32_t key;
+};
+
+// Writes input events to a compact binary stream: a header holding the
+// tick rate, then per event a varint step delta, the type, a varint
+// timestamp delta and a varint key. Events are attributed to the step they precede,
+// so replaying them at the same steps reproduces the run exactly whatever
+// the frame timing was.
+class InputRecorder
+{
+    public:
+        // An unclosed stream ends at its last event
+        ~InputRecorder() { Close(lastStep); }
+
+        bool Open(const std::string & path, float tick_rate);
+        bool IsOpen() const { return file != nullptr; }
+
+        // Events must come in step order
+        void Record(const InputEvent & event);
+        // Ends the stream after steps steps. Returns false if any of it could
+        // not be written.
+        bool Close(std::uint64_t steps);
+
+    private:
+        void put(std::uint64_t value);
+        void flush();
+
+        std::FILE * file = nullptr;
+        std::vector<unsigned char> buffer;
+        std::uint64_t lastStep = 0;
+        std::uint32_t lastTimestamp = 0;
+        bool failed = false;
+};
+
+// Reads a whole stream written by InputRecorder and hands its events back
+// step by step
+class InputReplay
+{
+    public:
+        // Returns false if the file is missing or not a complete stream
+        bool Open(const std::string & path);
+        bool IsOpen() const { return open; }
+
+        float TickRate() const { return tickRate; }
+        // Steps the recorded run took
+        std::uint64_t Steps() const { return steps; }
+
+        // Calls apply for every event of step, in recorded order. Steps must
+        // be asked for in increasing order.
+        template <typename Apply>
+        void Play(std::uint64_t step, Apply && apply)
+        {
+            while (cursor < events.size() && events[cursor].step <= step)
+                apply(events[cursor++]);
+        }
+
+    private:
+        std::vector<InputEvent> events;
+        std::size_t cursor = 0;
+        float tickRate = 0.0f;
+        std::uint64_t steps = 0;
+        bool open = false;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <cycle_clock.h>
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+
+// Calls below this level compile to nothing, arguments included. Build with
+// -DNOMAD_LOG_LEVEL=0 to keep everything.
+#ifndef NOMAD_LOG_LEVEL
+#define NOMAD_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RECORD_SIZE 128
+// Per thread; a power of two
+#define LOG_RING_RECORDS 4096
+
+// Usage: LOG_INFO("Loaded {} meshes in {} ms", count, ms);
+#define LOG_AT(threshold, level, ...)                  \
+    do                                                 \
+    {                                                  \
+        if constexpr ((threshold) >= NOMAD_LOG_LEVEL)  \
+            Log::Write(level, __VA_ARGS__);            \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, LogLevel::Error, __VA_ARGS__)
+
+enum class LogLevel : std::uint8_t
+{
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+// Type tag written before each argument in a record's payload
+enum class LogArg : std::uint8_t
+{
+    Int,
+    Uint,
+    Float,
+    Bool,
+    Char,
+    // Length byte, then that many chars
+    String,
+    // Pointer to a heap copy the consumer frees; for strings too long to inline
+    HeapString,
+    Pointer
+};
+
+// One log call. Only the format pointer is stored, so it must be a string
+// literal; "{}" in it is replaced by the next argument. Arguments are copied
+// into payload as a tag and raw value each. Those that do not fit are left
+// out and their "{}" printed as is.
+struct LogRecord
+{
+    const char * format;
+    std::uint64_t time;
+    LogLevel level;
+    std::uint8_t size;
+    std::uint8_t payload[LOG_RECORD_SIZE - sizeof(const char *) - sizeof(std::uint64_t) - 2];
+};
+
+static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "LogRecord must pack to LOG_RECORD_SIZE");
+
+// Single producer, single consumer ring owned by one logging thread
+struct LogRing
+{
+    alignas(64) std::atomic<std::uint32_t> head{0};
+    alignas(64) std::atomic<std::uint32_t> tail{0};
+    // Records lost because the ring was full; written by the producer only
+    alignas(64) std::atomic<std::uint64_t> dropped{0};
+    LogRecord records[LOG_RING_RECORDS];
+};
+
+// Asynchronous logger. A call stamps a CycleClock time and copies its
+// arguments into the calling thread's ring; nothing is formatted, locked or
+// written on that thread. A background thread, started by the first call,
+// drains every ring about once a millisecond, orders the records by time,
+// formats them and writes them to the output in one go. A full ring drops
+// records and reports how many were lost.
+namespace Log
+{
+    // Output for every record; stdout unless changed. Not owned.
+    void SetOutput(std::FILE * file);
+    // Writes everything logged so far before returning
+    void Flush();
+    // Flushes and stops the background thread. Also runs at exit.
+    void Shutdown();
+
+    namespace detail
+    {
+        LogRing * registerRing();
+
+        inline thread_local LogRing * thread_ring = nullptr;
+
+        class Encoder
+        {
+            public:
+                explicit Encoder(LogRecord & record) : record(record) {}
+
+                template <typename T>
+                void Put(LogArg tag, T value)
+                {
+                    if (record.size + 1 + sizeof(T) > sizeof(record.payload))
+                        return;
+                    record.payload[record.size] = static_cast<std::uint8_t>(tag);
+                    std::memcpy(record.payload + record.size + 1, &value, sizeof(T));
+                    record.size += static_cast<std::uint8_t>(1 + sizeof(T));
+                }
+
+                void PutString(const char * text, std::size_t length)
+                {
+                    std::size_t room = sizeof(record.payload) - record.size;
+                    if (length <= 255 && 2 + length <= room)
+                    {
+                        record.payload[record.size] = static_cast<std::uint8_t>(LogArg::String);
+                        record.payload[record.size + 1] = static_cast<std::uint8_t>(length);
+                        std::memcpy(record.payload + record.size + 2, text, length);
+                        record.size += static_cast<std::uint8_t>(2 + length);
+                        return;
+                    }
+
+                    if (1 + sizeof(char *) > room)
+                        return;
+                    char * copy = new char[length + 1];
+                    std::memcpy(copy, text, length);
+                    copy[length] = '\0';
+                    Put(LogArg::HeapString, copy);
+                }
+
+            private:
+                LogRecord & record;
+        };
+
+        template <typename T>
+        void encode(Encoder & encoder, const T & value)
+        {
+            using D = std::decay_t<T>;
+            if constexpr (std::is_same<D, bool>::value)
+                encoder.Put(LogArg::Bool, static_cast<std::uint8_t>(value));
+            else if constexpr (std::is_same<D, char>::value)
+                encoder.Put(LogArg::Char, value);
+            else if constexpr (std::is_enum<D>::value)
+                encode(encoder, static_cast<std::underlying_type_t<D>>(value));
+            else if constexpr (std::is_integral<D>::value && std::is_signed<D>::value)
+                encoder.Put(LogArg::Int, static_cast<std::int64_t>(value));
+            else if constexpr (std::is_integral<D>::value)
+                encoder.Put(LogArg::Uint, static_cast<std::uint64_t>(value));
+            else if constexpr (std::is_floating_point<D>::value)
+                encoder.Put(LogArg::Float, static_cast<double>(value));
+            else if constexpr (std::is_array<T>::value)
+                encoder.PutString(value, std::strlen(value));
+            else if constexpr (std::is_same<D, const char *>::value || std::is_same<D, char *>::value)
+                value ? encoder.PutString(value, std::strlen(value)) : encoder.PutString("(null)", 6);
+            else if constexpr (std::is_same<D, std::string>::value)
+                encoder.PutString(value.data(), value.size());
+            else if constexpr (std::is_pointer<D>::value)
+                encoder.Put(LogArg::Pointer, static_cast<const void *>(value));
+            else
+                static_assert(sizeof(D) == 0, "unsupported log argument type");
+        }
+    } // namespace detail
+
+    template <typename... Args>
+    void Write(LogLevel level, const char * format, const Args &... args)
+    {
+        LogRing * ring = detail::thread_ring;
+        if (!ring)
+            ring = detail::thread_ring = detail::registerRing();
+
+        std::uint32_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_RECORDS)
+        {
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        LogRecord & record = ring->records[head & (LOG_RING_RECORDS - 1)];
+        record.format = format;
+        record.time = CycleClock::Now();
+        record.level = level;
+        record.size = 0;
+
+        detail::Encoder encoder(record);
+        (detail::encode(encoder, args), ...);
+        (void)encoder;
+
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+}
+
+#endif
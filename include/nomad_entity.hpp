@@ -10,11 +10,18 @@
 #include <queue>
 #include <functional>
 #include <set>
-#include <glad/glad.h>
-#include <glm/ext.hpp>
+#include <cstdint>
+
+#include <profiler.h>
+
+// Component storage is sized up front; large scenes and benchmarks raise the
+// limit with -DNOMAD_MAX_ENTITIES=N
+#ifndef NOMAD_MAX_ENTITIES
+#define NOMAD_MAX_ENTITIES 5000
+#endif
 
 constexpr std::size_t MAX_COMPONENTS = 32;
-constexpr std::size_t MAX_ENTITIES = 5000;
+constexpr std::size_t MAX_ENTITIES = NOMAD_MAX_ENTITIES;
 
 using ComponentType = std::uint8_t;
 using Signature = std::bitset<MAX_COMPONENTS>;
@@ -51,7 +58,7 @@ public:
         size_t newIndex = mSize;
         mEntityToIndexMap[entity.id()] = newIndex;
         mIndexToEntityMap[newIndex] = entity.id();
-        mComponentArray[newIndex] = component;
+        mComponentArray[newIndex] = std::move(component);
         ++mSize;
     }
 
@@ -68,6 +75,9 @@ public:
         mEntityToIndexMap.erase(entity.id());
         mIndexToEntityMap.erase(indexOfLastElement);
 
+        // Reset the vacated slot so it does not keep resources alive
+        mComponentArray[indexOfLastElement] = T{};
+
         --mSize;
     }
 
@@ -195,6 +205,13 @@ private:
 class System
 {
 public:
+    virtual ~System() = default;
+
+    // Called after an entity joins or leaves mEntities. When it leaves because
+    // it was destroyed, its components are already gone.
+    virtual void entityAdded(Entity) {}
+    virtual void entityRemoved(Entity) {}
+
     std::set<Entity> mEntities;
 };
 
@@ -222,7 +239,8 @@ public:
         for (auto const &pair : mSystems)
         {
             auto const &system = pair.second;
-            system->mEntities.erase(entity);
+            if (system->mEntities.erase(entity))
+                system->entityRemoved(entity);
         }
     }
 
@@ -236,11 +254,12 @@ public:
 
             if ((entitySignature & systemSignature) == systemSignature)
             {
-                system->mEntities.insert(entity);
+                if (system->mEntities.insert(entity).second)
+                    system->entityAdded(entity);
             }
-            else
+            else if (system->mEntities.erase(entity))
             {
-                system->mEntities.erase(entity);
+                system->entityRemoved(entity);
             }
         }
     }
@@ -271,11 +290,13 @@ public:
     // Entity methods
     Entity createEntity()
     {
+        PROFILE_SCOPE("ECS::createEntity");
         return mEntityManager->createEntity();
     }
 
     void destroyEntity(Entity entity)
     {
+        PROFILE_SCOPE("ECS::destroyEntity");
         mEntityManager->destroyEntity(entity);
         mComponentManager->entityDestroyed(entity);
         mSystemManager->entityDestroyed(entity);
@@ -291,6 +312,7 @@ public:
     template <typename T>
     void addComponent(Entity entity, T component)
     {
+        PROFILE_SCOPE("ECS::addComponent");
         mComponentManager->addComponent<T>(entity, component);
 
         auto signature = mEntityManager->getSignature(entity);
@@ -303,6 +325,7 @@ public:
     template <typename T>
     void removeComponent(Entity entity)
     {
+        PROFILE_SCOPE("ECS::removeComponent");
         mComponentManager->removeComponent<T>(entity);
 
         auto signature = mEntityManager->getSignature(entity);
@@ -324,6 +347,12 @@ public:
         return mComponentManager->getComponentType<T>();
     }
 
+    template <typename T>
+    bool hasComponent(Entity entity)
+    {
+        return mEntityManager->getSignature(entity).test(mComponentManager->getComponentType<T>());
+    }
+
     // System methods
     template <typename T>
     std::shared_ptr<T> registerSystem()
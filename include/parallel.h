@@ -0,0 +1,25 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+// Persistent worker pool for data-parallel frame work. Run() hands out task
+// indices to the workers and the calling thread and returns once every task
+// has finished, so results can be read straight away. Calls must not nest.
+namespace Parallel
+{
+    // Workers plus the calling thread; at least 1
+    unsigned int ThreadCount();
+
+    void Run(unsigned int count, const std::function<void(unsigned int task)> & task);
+
+    // Splits [0, size) into one contiguous range per thread, at least
+    // minRange long, and runs fn(begin, end, task) on each
+    void For(std::size_t size, std::size_t minRange,
+             const std::function<void(std::size_t begin, std::size_t end, unsigned int task)> & fn);
+
+    // Number of ranges For() would split size into
+    unsigned int RangeCount(std::size_t size, std::size_t minRange);
+}
+
+#endif
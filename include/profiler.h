@@ -0,0 +1,112 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <cycle_clock.h>
+
+// Zones only exist in builds with -DNOMAD_PROFILE=1 (make profile). Without
+// it PROFILE_SCOPE and PROFILE_FRAME expand to nothing.
+#ifndef NOMAD_PROFILE
+#define NOMAD_PROFILE 0
+#endif
+
+// Zones kept per thread; a power of two. Older ones are overwritten.
+#define PROFILER_RING_EVENTS (1 << 16)
+// Frame boundaries kept for export
+#define PROFILER_MAX_FRAMES 1024
+#define PROFILER_EXPORT_FRAMES 120
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if NOMAD_PROFILE
+// Times the rest of the enclosing scope. name must be a string literal.
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+// Marks the start of a frame; call once per frame on the main thread
+#define PROFILE_FRAME() Profiler::FrameMark()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME()
+#endif
+
+struct ProfileEvent
+{
+    const char * name;
+    std::uint64_t begin;
+    std::uint64_t end;
+};
+
+// Written by one thread only. The exporter copies from it while it is
+// written and keeps only the events head shows were not overwritten.
+struct ProfileRing
+{
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    std::uint32_t thread = 0;
+    // Set for tracks; thread rings are named by the exporter
+    const char * name = nullptr;
+    ProfileEvent events[PROFILER_RING_EVENTS];
+};
+
+// Flight recorder for CPU zones. Each zone costs two CycleClock reads and
+// one store into the calling thread's ring; nothing is locked, allocated or
+// formatted until a trace is written.
+namespace Profiler
+{
+    // Starts a new frame and records the previous one as a "Frame" zone
+    void FrameMark();
+
+    // Writes the zones of the last frames in Chrome trace_event JSON, which
+    // chrome://tracing and Perfetto open. Call from the thread that marks
+    // frames. Returns false if the file could not be written.
+    bool WriteChromeTrace(const std::string & path, std::size_t frames = PROFILER_EXPORT_FRAMES);
+
+    namespace detail
+    {
+        ProfileRing * registerRing(const char * name = nullptr);
+
+        inline thread_local ProfileRing * thread_ring = nullptr;
+
+        inline void push(ProfileRing & ring, const char * name, std::uint64_t begin, std::uint64_t end)
+        {
+            std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+            ring.events[head & (PROFILER_RING_EVENTS - 1)] = ProfileEvent{name, begin, end};
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+
+        inline void record(const char * name, std::uint64_t begin, std::uint64_t end)
+        {
+            ProfileRing * ring = thread_ring;
+            if (!ring)
+                ring = thread_ring = registerRing();
+            push(*ring, name, begin, end);
+        }
+    } // namespace detail
+
+    // A timeline of its own for events not timed by a CPU thread, such as
+    // GPU work. Lives as long as the program.
+    ProfileRing * CreateTrack(const char * name);
+    // begin and end are CycleClock ticks. Only one thread may write a track.
+    inline void RecordOn(ProfileRing * track, const char * name, std::uint64_t begin, std::uint64_t end)
+    {
+        detail::push(*track, name, begin, end);
+    }
+}
+
+class ProfileZone
+{
+    public:
+        explicit ProfileZone(const char * name) : name(name), begin(CycleClock::Now()) {}
+        ~ProfileZone() { Profiler::detail::record(name, begin, CycleClock::Now()); }
+
+        ProfileZone(const ProfileZone &) = delete;
+        ProfileZone & operator=(const ProfileZone &) = delete;
+
+    private:
+        const char * name;
+        std::uint64_t begin;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef RECORDING_DEVICE_H
+#define RECORDING_DEVICE_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include <render_device.h>
+
+enum class RecordedOp : std::uint8_t
+{
+    UseProgram,
+    BindVertexArray,
+    BindBuffer,
+    BindBufferBase,
+    BindBufferRange,
+    ActiveTexture,
+    BindTexture,
+    Enable,
+    Disable,
+    ClearColor,
+    BufferData,
+    BufferSubData,
+    CopyBufferSubData,
+    ProgramUniform,
+    Clear,
+    DispatchCompute,
+    Barrier,
+    MultiDrawElementsIndirect,
+    Finish,
+    FenceSync,
+    QueryTimestamp,
+    Count
+};
+
+// One captured call. Fields not used by an op are zero.
+struct RecordedCommand
+{
+    RecordedOp op;
+    // Target, capability, uniform type, barrier or clear bits, or draw mode
+    GLenum target;
+    // Program, vertex array, buffer or texture name
+    GLuint object;
+    // Binding index, uniform location or texture unit
+    GLuint index;
+    GLintptr offset;
+    // Bytes, or the number of indirect commands of a draw
+    GLsizeiptr size;
+};
+
+// State a multi-draw was issued with. Its commands are copied out of the
+// indirect buffer at submission, so later writes to the ring do not change them.
+struct RecordedDraw
+{
+    GLuint program;
+    GLuint vao;
+    GLenum mode;
+    std::uint32_t firstCommand;
+    std::uint32_t commandCount;
+};
+
+// Render device that needs no GL context. Calls are appended to an in-memory
+// command list, buffers are plain byte arrays (mapped pointers point straight
+// into them) and names are handed out sequentially. Nothing executes: compute
+// dispatches write nothing and shaders expose no uniforms.
+//
+// Used for benchmarking submission cost and for checking what the renderer
+// actually asked for, e.g. how many draws a frame took and with which counts.
+class RecordingDevice : public RenderDevice
+{
+    public:
+        explicit RecordingDevice(GLint storage_alignment = 64) : storageAlignment(storage_alignment) {}
+
+        // Drops the recorded commands and draws. Objects and buffer contents stay.
+        void Reset();
+
+        const std::vector<RecordedCommand> & Commands() const { return commands; }
+        std::size_t Count(RecordedOp op) const { return counts[static_cast<std::size_t>(op)]; }
+
+        const std::vector<RecordedDraw> & Draws() const { return draws; }
+        const std::vector<DrawElementsIndirectCommand> & IndirectCommands() const { return indirect; }
+
+        // Current contents, including writes made through a mapped pointer.
+        // Empty for names that were never created or have been deleted.
+        const std::vector<unsigned char> & BufferBytes(GLuint buffer) const;
+        // Bytes passed to BufferData and BufferSubData since the last Reset
+        std::size_t UploadedBytes() const { return uploadedBytes; }
+
+        GLuint BoundProgram() const { return program; }
+        GLuint BoundVertexArray() const { return vao; }
+
+        RenderDeviceCaps Caps() override;
+        GLenum GetError() override { return GL_NO_ERROR; }
+
+        void UseProgram(GLuint program) override;
+        void BindVertexArray(GLuint vao) override;
+        void BindBuffer(GLenum target, GLuint buffer) override;
+        void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+        void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+        void ActiveTexture(GLenum unit) override;
+        void BindTexture(GLenum target, GLuint texture) override;
+        void SetCapability(GLenum capability, bool enabled) override;
+        void ClearColor(float r, float g, float b, float a) override;
+
+        GLuint CreateBuffer() override;
+        void BufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum usage) override;
+        void BufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data) override;
+        void CopyBufferSubData(GLuint source, GLuint destination, GLintptr source_offset, GLintptr destination_offset, GLsizeiptr size) override;
+        void * MapPersistent(GLuint buffer, GLsizeiptr size) override;
+        void Unmap(GLuint) override {}
+        void DeleteBuffer(GLuint buffer) override;
+
+        GLuint CreateVertexArray() override { return ++lastVertexArray; }
+        void VertexArrayAttrib(GLuint, GLuint, GLint, GLenum, GLuint, GLuint) override {}
+        void VertexArrayVertexBuffer(GLuint, GLuint, GLuint, GLintptr, GLsizei) override {}
+        void VertexArrayElementBuffer(GLuint, GLuint) override {}
+        void DeleteVertexArray(GLuint) override {}
+
+        GLuint CreateTexture2D(GLsizei, GLsizei, GLenum, const void *) override { return ++lastTexture; }
+        void DeleteTexture(GLuint) override {}
+
+        GLuint CreateProgram(const ShaderStage *, int) override { return ++lastProgram; }
+        std::vector<UniformInfo> ActiveUniforms(GLuint) override { return {}; }
+        void ProgramUniform(GLuint program, GLint location, GLenum type, const void * value) override;
+        void DeleteProgram(GLuint) override {}
+
+        void Clear(GLbitfield mask) override;
+        void DispatchCompute(GLuint x, GLuint y, GLuint z) override;
+        void Barrier(GLbitfield barriers) override;
+        void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei count, GLsizei stride) override;
+        void Finish() override;
+
+        // Nothing is in flight, so fences are null and never waited on
+        GLsync FenceSync() override;
+        void WaitSync(GLsync) override {}
+        void DeleteSync(GLsync) override {}
+
+        // Queries are stamped with steady_clock when recorded and are
+        // available at once, so GPU zones show when their commands were
+        // submitted
+        void CreateQueries(GLsizei count, GLuint * queries) override;
+        void DeleteQueries(GLsizei, const GLuint *) override {}
+        void QueryTimestamp(GLuint query) override;
+        bool QueryAvailable(GLuint) override { return true; }
+        GLuint64 QueryResult(GLuint query) override;
+        GLint64 Timestamp() override;
+
+    private:
+        void record(RecordedOp op, GLenum target = 0, GLuint object = 0, GLuint index = 0, GLintptr offset = 0, GLsizeiptr size = 0);
+        std::vector<unsigned char> * bytes(GLuint buffer);
+
+        GLint storageAlignment;
+
+        std::vector<RecordedCommand> commands;
+        std::array<std::size_t, static_cast<std::size_t>(RecordedOp::Count)> counts{};
+        std::vector<RecordedDraw> draws;
+        std::vector<DrawElementsIndirectCommand> indirect;
+        std::size_t uploadedBytes = 0;
+
+        // Indexed by name - 1
+        std::vector<std::vector<unsigned char>> buffers;
+        GLuint lastVertexArray = 0;
+        GLuint lastTexture = 0;
+        GLuint lastProgram = 0;
+        // Indexed by name - 1
+        std::vector<GLuint64> queryTimes;
+
+        GLuint program = 0;
+        GLuint vao = 0;
+        GLuint indirectBuffer = 0;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef RENDER_DEVICE_H
+#define RENDER_DEVICE_H
+
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct RenderDeviceCaps
+{
+    GLint storageAlignment = 1;
+    // False when submitted work never runs, so GPU results such as culled
+    // instance counts cannot be relied on
+    bool executes = true;
+};
+
+struct ShaderStage
+{
+    GLenum type;
+    const char * source;
+};
+
+// An active uniform outside any block
+struct UniformInfo
+{
+    std::string name;
+    GLenum type;
+    GLint location;
+};
+
+// Every graphics API call the engine makes goes through the current device.
+// GLState sits in front of it and drops redundant binds, so a device only
+// sees state changes that would reach the driver. Buffers, vertex arrays and
+// textures are addressed by name, never through a binding point.
+//
+// GLDevice forwards to glad and needs a current context. RecordingDevice
+// (recording_device.h) needs none and captures the command stream instead.
+class RenderDevice
+{
+    public:
+        virtual ~RenderDevice() = default;
+
+        // The device engine code submits to; a GLDevice unless replaced
+        static RenderDevice & Current();
+        // Installs device, or the GLDevice again for nullptr, and forgets the
+        // GLState shadow. Objects created on one device are not valid on another.
+        static void SetCurrent(RenderDevice * device);
+
+        virtual RenderDeviceCaps Caps() = 0;
+        virtual GLenum GetError() = 0;
+
+        virtual void UseProgram(GLuint program) = 0;
+        virtual void BindVertexArray(GLuint vao) = 0;
+        virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+        virtual void BindBufferBase(GLenum target, GLuint index, GLuint buffer) = 0;
+        virtual void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) = 0;
+        virtual void ActiveTexture(GLenum unit) = 0;
+        virtual void BindTexture(GLenum target, GLuint texture) = 0;
+        virtual void SetCapability(GLenum capability, bool enabled) = 0;
+        virtual void ClearColor(float r, float g, float b, float a) = 0;
+
+        virtual GLuint CreateBuffer() = 0;
+        virtual void BufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum usage) = 0;
+        virtual void BufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data) = 0;
+        virtual void CopyBufferSubData(GLuint source, GLuint destination, GLintptr source_offset, GLintptr destination_offset, GLsizeiptr size) = 0;
+        // Gives buffer immutable storage mapped persistent and coherent for
+        // writing. Returns nullptr on failure.
+        virtual void * MapPersistent(GLuint buffer, GLsizeiptr size) = 0;
+        virtual void Unmap(GLuint buffer) = 0;
+        virtual void DeleteBuffer(GLuint buffer) = 0;
+
+        virtual GLuint CreateVertexArray() = 0;
+        // Enables a float attribute and sources it from binding
+        virtual void VertexArrayAttrib(GLuint vao, GLuint index, GLint size, GLenum type, GLuint offset, GLuint binding) = 0;
+        virtual void VertexArrayVertexBuffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride) = 0;
+        virtual void VertexArrayElementBuffer(GLuint vao, GLuint buffer) = 0;
+        virtual void DeleteVertexArray(GLuint vao) = 0;
+
+        // Repeat-wrapped, linearly filtered and mipmapped; format is GL_RGB or GL_RGBA
+        virtual GLuint CreateTexture2D(GLsizei width, GLsizei height, GLenum format, const void * pixels) = 0;
+        virtual void DeleteTexture(GLuint texture) = 0;
+
+        // Compile and link errors are logged; a program name is returned anyway
+        virtual GLuint CreateProgram(const ShaderStage * stages, int count) = 0;
+        virtual std::vector<UniformInfo> ActiveUniforms(GLuint program) = 0;
+        // type is the GL type of value: GL_FLOAT, GL_INT, GL_UNSIGNED_INT,
+        // GL_FLOAT_VEC3, GL_FLOAT_VEC4 or GL_FLOAT_MAT4
+        virtual void ProgramUniform(GLuint program, GLint location, GLenum type, const void * value) = 0;
+        virtual void DeleteProgram(GLuint program) = 0;
+
+        virtual void Clear(GLbitfield mask) = 0;
+        virtual void DispatchCompute(GLuint x, GLuint y, GLuint z) = 0;
+        virtual void Barrier(GLbitfield barriers) = 0;
+        // offset is into the bound GL_DRAW_INDIRECT_BUFFER
+        virtual void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei count, GLsizei stride) = 0;
+        virtual void Finish() = 0;
+
+        virtual GLsync FenceSync() = 0;
+        // Blocks until fence has signalled
+        virtual void WaitSync(GLsync fence) = 0;
+        virtual void DeleteSync(GLsync fence) = 0;
+
+        // GL_TIMESTAMP queries. A query is stamped with the GPU time at which
+        // all commands issued before it have completed.
+        virtual void CreateQueries(GLsizei count, GLuint * queries) = 0;
+        virtual void DeleteQueries(GLsizei count, const GLuint * queries) = 0;
+        virtual void QueryTimestamp(GLuint query) = 0;
+        // True once the result can be read without waiting for the GPU
+        virtual bool QueryAvailable(GLuint query) = 0;
+        // Nanoseconds on the GPU clock; blocks if not yet available
+        virtual GLuint64 QueryResult(GLuint query) = 0;
+        // The GPU clock now, without waiting for submitted work
+        virtual GLint64 Timestamp() = 0;
+};
+
+class GLDevice : public RenderDevice
+{
+    public:
+        RenderDeviceCaps Caps() override;
+        GLenum GetError() override;
+
+        void UseProgram(GLuint program) override;
+        void BindVertexArray(GLuint vao) override;
+        void BindBuffer(GLenum target, GLuint buffer) override;
+        void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+        void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+        void ActiveTexture(GLenum unit) override;
+        void BindTexture(GLenum target, GLuint texture) override;
+        void SetCapability(GLenum capability, bool enabled) override;
+        void ClearColor(float r, float g, float b, float a) override;
+
+        GLuint CreateBuffer() override;
+        void BufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum usage) override;
+        void BufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data) override;
+        void CopyBufferSubData(GLuint source, GLuint destination, GLintptr source_offset, GLintptr destination_offset, GLsizeiptr size) override;
+        void * MapPersistent(GLuint buffer, GLsizeiptr size) override;
+        void Unmap(GLuint buffer) override;
+        void DeleteBuffer(GLuint buffer) override;
+
+        GLuint CreateVertexArray() override;
+        void VertexArrayAttrib(GLuint vao, GLuint index, GLint size, GLenum type, GLuint offset, GLuint binding) override;
+        void VertexArrayVertexBuffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride) override;
+        void VertexArrayElementBuffer(GLuint vao, GLuint buffer) override;
+        void DeleteVertexArray(GLuint vao) override;
+
+        GLuint CreateTexture2D(GLsizei width, GLsizei height, GLenum format, const void * pixels) override;
+        void DeleteTexture(GLuint texture) override;
+
+        GLuint CreateProgram(const ShaderStage * stages, int count) override;
+        std::vector<UniformInfo> ActiveUniforms(GLuint program) override;
+        void ProgramUniform(GLuint program, GLint location, GLenum type, const void * value) override;
+        void DeleteProgram(GLuint program) override;
+
+        void Clear(GLbitfield mask) override;
+        void DispatchCompute(GLuint x, GLuint y, GLuint z) override;
+        void Barrier(GLbitfield barriers) override;
+        void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei count, GLsizei stride) override;
+        void Finish() override;
+
+        GLsync FenceSync() override;
+        void WaitSync(GLsync fence) override;
+        void DeleteSync(GLsync fence) override;
+
+        void CreateQueries(GLsizei count, GLuint * queries) override;
+        void DeleteQueries(GLsizei count, const GLuint * queries) override;
+        void QueryTimestamp(GLuint query) override;
+        bool QueryAvailable(GLuint query) override;
+        GLuint64 QueryResult(GLuint query) override;
+        GLint64 Timestamp() override;
+};
+
+#endif
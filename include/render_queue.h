@@ -0,0 +1,52 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+
+// Sort key layout, most significant first:
+//   layer 4 | program 12 | material 12 | mesh 12 | depth 24
+// Sorting by key groups packets by render state, then by mesh (which selects
+// the VAO and its index range), and within one mesh orders them front to back.
+#define SORT_KEY_LAYER_BITS 4
+#define SORT_KEY_PROGRAM_BITS 12
+#define SORT_KEY_MATERIAL_BITS 12
+#define SORT_KEY_MESH_BITS 12
+#define SORT_KEY_DEPTH_BITS 24
+
+struct DrawPacket
+{
+    std::uint64_t key;
+    std::uint32_t mesh;
+    std::uint32_t shader;
+    std::uint32_t material;
+    std::uint32_t instance;
+};
+
+class RenderQueue
+{
+    public:
+        // depth is expected in [0, 1]; values outside are clamped
+        static std::uint64_t MakeKey(std::uint32_t layer, std::uint32_t program, std::uint32_t material, std::uint32_t mesh, float depth);
+
+        // Key bits that select a draw, i.e. everything above depth
+        static std::uint64_t DrawBits(std::uint64_t key) { return key >> SORT_KEY_DEPTH_BITS; }
+        // Key bits that select pipeline state: layer, program and material
+        static std::uint64_t StateBits(std::uint64_t key) { return key >> (SORT_KEY_DEPTH_BITS + SORT_KEY_MESH_BITS); }
+
+        void Clear() { packets.clear(); }
+        void Push(const DrawPacket & packet) { packets.push_back(packet); }
+
+        // LSD radix sort on the 64-bit keys, 8 bits per pass. Passes whose
+        // digit is the same for every packet are skipped.
+        void Sort();
+
+        const std::vector<DrawPacket> & Packets() const { return packets; }
+        std::size_t Size() const { return packets.size(); }
+
+    private:
+        std::vector<DrawPacket> packets;
+        std::vector<DrawPacket> scratch;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/ext.hpp>
+
+#include <gl_state.h>
+#include <render_device.h>
+#include <resource_loader.h>
+#include <camera.h>
+#include <stream_buffer.h>
+#include <render_queue.h>
+#include <gpu_profiler.h>
+
+// SSBO binding point the vertex shader reads per-instance data from
+#define INSTANCE_BUFFER_BINDING 0
+
+// SSBO binding points of shaders/cull.glsl. Visible instances are written to
+// INSTANCE_BUFFER_BINDING, where the draw reads them.
+#define CULL_INSTANCES_BINDING 1
+#define CULL_DATA_BINDING 2
+#define CULL_COMMANDS_BINDING 3
+#define CULL_GROUP_SIZE 64
+
+// Matches the std430 Instance struct in shaders/vert.glsl
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// Matches the std430 CullData struct in shaders/cull.glsl
+struct CullData
+{
+    glm::vec4 sphere;
+    GLuint command;
+    GLuint padding[3];
+};
+
+// Work of one frame, counted from BeginFrame through Flush
+struct RenderStats
+{
+    // One multi-draw per state bucket, holding one command per mesh run
+    unsigned int drawCalls = 0;
+    unsigned int commands = 0;
+    unsigned int instances = 0;
+    // Submitted, before GPU culling
+    std::uint64_t triangles = 0;
+    // Binds that reached the device, after GLState dropped redundant ones
+    unsigned int programBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int bufferBinds = 0;
+    // Calls GLState dropped because they would not have changed anything
+    unsigned int elidedCalls = 0;
+    unsigned int uniformUploads = 0;
+    // Written to GPU buffers: instances, culling input, commands and camera
+    std::uint64_t bytesUploaded = 0;
+    // Commands whose GPU-culled instance count disagreed with the CPU reference
+    unsigned int cullMismatches = 0;
+};
+
+// Submissions become draw packets in a RenderQueue. Each frame the queue is
+// radix sorted; consecutive packets with the same mesh become one indirect
+// command, and every bucket of packets sharing layer, program, material and
+// VAO is drawn with a single glMultiDrawElementsIndirect. Only the state that
+// differs from the previous bucket is rebound. Instance data and indirect
+// commands are written once per frame into persistently mapped rings (see
+// StreamBuffer); shaders find their instance with gl_BaseInstance +
+// gl_InstanceID. The camera lives in a UBO read from CAMERA_UBO_BINDING.
+//
+// With GPU culling on, commands are uploaded with zero instances and a
+// compute pass tests every instance's bounding sphere against the camera
+// frustum, compacting the visible ones and counting them into the commands.
+// Devices that do not execute work (see RenderDeviceCaps) skip the culling
+// pass, so their recorded draws carry the real instance counts. Init picks
+// this up from RenderDevice::Current(), which every GL call goes through.
+class Renderer
+{
+    public:
+        void Init();
+        void Shutdown();
+
+        // Starts a frame and its stats; call before SetCamera. The bind
+        // counts are GLState::FrameCounters deltas, so leave those alone
+        // until Flush.
+        void BeginFrame();
+        // Packets reference assets by id, so the handles must outlive Flush
+        void Submit(const ResourceLoader::MeshHandle & mesh, const ResourceLoader::ShaderHandle & shader, const glm::mat4 & model, const glm::vec4 & color, std::uint32_t layer = 0, std::uint32_t material = 0);
+        // Uploads the camera block if the camera changed since the last frame
+        void SetCamera(Camera & camera);
+        void Flush();
+
+        // Call before Init, which turns culling off on devices that do not
+        // execute work
+        void SetGpuCulling(bool enabled) { gpuCulling = enabled; }
+        bool GpuCulling() const { return gpuCulling; }
+        // Reads the culled counts back every frame and compares them with a
+        // CPU reference culler. Stalls the pipeline; for testing only.
+        void SetCullingCrossCheck(bool enabled) { cullCrossCheck = enabled; }
+
+        const RenderStats & Stats() const { return stats; }
+        // GPU time of the culling and draw passes, a few frames behind
+        const GpuProfiler & GpuTimings() const { return gpuProfiler; }
+
+    private:
+        struct Bucket
+        {
+            std::uint32_t shader;
+            GLuint vao;
+            std::uint32_t firstCommand;
+            std::uint32_t commandCount;
+        };
+
+        bool uploadInstances();
+        void buildCommands();
+        bool uploadCommands();
+        void cullInstances();
+        void crossCheckCulling();
+        void drawBuckets();
+        void countState();
+
+        RenderQueue queue;
+        std::vector<InstanceData> instances;
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<Bucket> buckets;
+        std::vector<CullData> cullData;
+
+        StreamBuffer instanceStream;
+        StreamRange instanceRange;
+        GLint storageAlignment = 1;
+
+        StreamBuffer commandStream;
+        StreamRange commandRange;
+
+        bool gpuCulling = true;
+        bool cullCrossCheck = false;
+        ResourceLoader::ShaderHandle cullShader;
+        int cullInstanceCount = UniformTable::NOT_FOUND;
+        StreamRange cullRange;
+        GLuint visibleBuffer = 0;
+        GLsizeiptr visibleCapacity = 0;
+
+        GLuint cameraBuffer = 0;
+        std::uint32_t cameraVersion = 0;
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        Frustum frustum{};
+        float farPlane = 1.0f;
+
+        RenderStats stats;
+        // Device counters as they stood at BeginFrame
+        GLState::Counters frameStartState;
+        std::uint64_t frameStartUniforms = 0;
+        GpuProfiler gpuProfiler;
+};
+
+#endif
@@ -5,14 +5,82 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstdint>
+#include <utility>
 #include <glad/glad.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <glm/ext.hpp>
+
+#include <uniform_table.h>
+#include <gl_state.h>
+#include <render_device.h>
 
 namespace ResourceLoader
 {
+    // A range of the shared mesh pool. Every mesh uses the pool's VAO, so
+    // different meshes can be drawn by one multi-draw call.
+    struct Mesh
+    {
+        GLuint VAO = 0;
+        GLsizei indexCount = 0;
+        GLuint firstIndex = 0;
+        GLint baseVertex = 0;
+        // Local bounding sphere: xyz center, w radius
+        glm::vec4 bounds = glm::vec4(0.0f);
+    };
+
+    struct Shader
+    {
+        GLuint program = 0;
+        UniformTable uniforms;
+    };
+
+    // Ref-counted reference into the asset cache. The GL objects behind it are
+    // deleted when the last handle to an asset goes away.
+    template <typename T>
+    class AssetHandle
+    {
+        public:
+            static constexpr std::uint32_t INVALID = 0xFFFFFFFF;
+
+            AssetHandle() = default;
+            explicit AssetHandle(std::uint32_t id) : id(id) { acquire(); }
+            AssetHandle(const AssetHandle & other) : id(other.id) { acquire(); }
+            AssetHandle(AssetHandle && other) noexcept : id(other.id) { other.id = INVALID; }
+            AssetHandle & operator=(AssetHandle other) noexcept { std::swap(id, other.id); return *this; }
+            ~AssetHandle() { release(); }
+
+            bool Valid() const { return id != INVALID; }
+            std::uint32_t Id() const { return id; }
+            T & Get() const { return Resolve(id); }
+
+            // Looks up a cached asset by Id() without taking a reference
+            static T & Resolve(std::uint32_t id);
+
+        private:
+            void acquire();
+            void release();
+
+            std::uint32_t id = INVALID;
+    };
+
+    using MeshHandle = AssetHandle<Mesh>;
+    using ShaderHandle = AssetHandle<Shader>;
+
     GLuint LoadShaderGL(const char * vertex_shader_path, const char * fragment_shader_path);
+    GLuint LoadComputeShaderGL(const char * compute_shader_path);
     GLuint LoadImageGL(const char * image_file_path);
+
+    // Cached loaders: identical requests share one set of GL objects
+    ShaderHandle LoadShader(const char * vertex_shader_path, const char * fragment_shader_path);
+    ShaderHandle LoadComputeShader(const char * compute_shader_path);
+    // Position-only (vec3 at attribute 0) indexed mesh, keyed by name and
+    // appended to the shared mesh pool
+    MeshHandle LoadMesh(const std::string & key, const float * vertices, GLsizeiptr vertices_size, const unsigned int * indices, GLsizei index_count);
+
+    // Deletes every cached GL object; call before the context is destroyed
+    void ReleaseAll();
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,164 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include <glm/ext.hpp>
+
+#include <nomad_entity.hpp>
+
+// Items per parallel range during a rebuild, and the smallest hash table
+#define SPATIAL_GRID_MIN_RANGE 8192
+#define SPATIAL_GRID_MIN_TABLE 1024
+
+// A run of consecutive slots in the grid's sorted arrays
+struct GridSpan
+{
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+};
+
+// Uniform grid over an unbounded world. Cells hash into a power-of-two table
+// sized to the item count; Build() counting-sorts items by bucket in parallel
+// into flat arrays, so every bucket is one contiguous span and nothing is
+// allocated per cell. Buckets can hold items from colliding cells, which is why
+// each slot also keeps the key of the cell it came from.
+class SpatialGrid
+{
+    public:
+        void Build(const glm::vec3 * positions, std::size_t count, float cellSize);
+
+        // Visits the slot of every item within radius of center exactly once
+        template <typename F>
+        void ForEachInRadius(const glm::vec3 & center, float radius, F && visit) const;
+
+        // Spans of the buckets touched by the sphere, each bucket once. Spans
+        // may hold items outside the radius. Returns the number of spans
+        // found, which can exceed maxSpans; only maxSpans are written.
+        std::size_t QueryCells(const glm::vec3 & center, float radius, GridSpan * spans, std::size_t maxSpans) const;
+
+        // Input index of every item within radius
+        void QueryRadius(const glm::vec3 & center, float radius, std::vector<std::uint32_t> & out) const;
+
+        // Sorted arrays, indexed by slot
+        const glm::vec3 & Position(std::uint32_t slot) const { return sortedPosition[slot]; }
+        std::uint32_t Index(std::uint32_t slot) const { return sortedIndex[slot]; }
+
+        std::size_t Size() const { return sortedIndex.size(); }
+        std::size_t TableSize() const { return tableMask + 1; }
+        float CellSize() const { return cellSize; }
+
+    private:
+        int cellCoord(float x) const { return static_cast<int>(std::floor(x * inverseCellSize)); }
+
+        static std::uint64_t cellKey(int x, int y, int z)
+        {
+            // 21 bits per axis covers +-1M cells
+            const std::uint64_t mask = (1u << 21) - 1;
+            return ((static_cast<std::uint64_t>(x) & mask) << 42) |
+                   ((static_cast<std::uint64_t>(y) & mask) << 21) |
+                   (static_cast<std::uint64_t>(z) & mask);
+        }
+
+        // Linear in x, so a row of cells maps to consecutive buckets and a
+        // query reads one contiguous run of slots per row
+        std::uint32_t bucketOf(int x, int y, int z) const
+        {
+            std::uint32_t h = static_cast<std::uint32_t>(x) +
+                              static_cast<std::uint32_t>(y) * 2654435761u +
+                              static_cast<std::uint32_t>(z) * 2246822519u;
+            return h & tableMask;
+        }
+
+        float cellSize = 1.0f;
+        float inverseCellSize = 1.0f;
+        std::uint32_t tableMask = 0;
+
+        // First slot per bucket, plus one end entry
+        std::vector<std::uint32_t> bucketStart;
+
+        // Per input item, filled by the counting pass
+        std::vector<std::uint32_t> itemBucket;
+        std::vector<std::uint64_t> itemCell;
+
+        // Per range and bucket: counts, then scatter cursors
+        std::vector<std::uint32_t> rangeCounts;
+        std::vector<std::uint32_t> blockTotals;
+
+        std::vector<glm::vec3> sortedPosition;
+        std::vector<std::uint32_t> sortedIndex;
+        std::vector<std::uint64_t> sortedCell;
+};
+
+template <typename F>
+void SpatialGrid::ForEachInRadius(const glm::vec3 & center, float radius, F && visit) const
+{
+    if (sortedIndex.empty())
+        return;
+
+    const int x0 = cellCoord(center.x - radius), x1 = cellCoord(center.x + radius);
+    const int y0 = cellCoord(center.y - radius), y1 = cellCoord(center.y + radius);
+    const int z0 = cellCoord(center.z - radius), z1 = cellCoord(center.z + radius);
+    const float radiusSquared = radius * radius;
+
+    for (int z = z0; z <= z1; ++z)
+    {
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                const std::uint32_t bucket = bucketOf(x, y, z);
+                const std::uint64_t key = cellKey(x, y, z);
+                const std::uint32_t end = bucketStart[bucket + 1];
+
+                for (std::uint32_t slot = bucketStart[bucket]; slot < end; ++slot)
+                {
+                    // Skips items of other cells hashed into the same bucket
+                    if (sortedCell[slot] != key)
+                        continue;
+
+                    glm::vec3 d = sortedPosition[slot] - center;
+                    if (glm::dot(d, d) <= radiusSquared)
+                        visit(slot);
+                }
+            }
+        }
+    }
+}
+
+struct SpatialGridStats
+{
+    unsigned int entities = 0;
+    double gatherMs = 0.0;
+    double buildMs = 0.0;
+};
+
+// Indexes the world position of every entity in its signature, which must
+// include Transform. Update() regathers positions and rebuilds the grid.
+class SpatialGridSystem : public System
+{
+    public:
+        void Init(ECS * ecs, float cellSize);
+        void Update();
+
+        const SpatialGrid & Grid() const { return grid; }
+        Entity EntityAt(std::uint32_t slot) const { return Entity(entities[grid.Index(slot)]); }
+
+        void QueryRadius(const glm::vec3 & center, float radius, std::vector<Entity> & out) const;
+
+        const SpatialGridStats & Stats() const { return stats; }
+
+    private:
+        ECS * ecs = nullptr;
+        float cellSize = 1.0f;
+
+        SpatialGrid grid;
+        std::vector<glm::vec3> positions;
+        std::vector<int> entities;
+
+        SpatialGridStats stats;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <atomic>
+#include <array>
+
+#include <glad/glad.h>
+
+#include <gl_state.h>
+#include <render_device.h>
+
+#define STREAM_BUFFER_FRAMES 3
+
+// A sub-range handed out by StreamBuffer::Allocate. data points into the
+// persistently mapped buffer; offset is relative to the start of the buffer
+// and can be passed straight to glBindBufferRange or used as a draw offset.
+struct StreamRange
+{
+    void * data = nullptr;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+
+    bool Valid() const { return data != nullptr; }
+};
+
+// Ring of STREAM_BUFFER_FRAMES regions inside one buffer created with
+// glBufferStorage and mapped once, persistent and coherent. Each frame writes
+// into its own region; a fence placed at EndFrame keeps the CPU from reusing
+// a region until the GPU has consumed it.
+//
+// Allocate is lock-free and may be called from worker threads between
+// BeginFrame and EndFrame. Writes through the returned pointers must finish
+// before the draws that read them are submitted.
+class StreamBuffer
+{
+    public:
+        StreamBuffer() = default;
+        StreamBuffer(const StreamBuffer&) = delete;
+        StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+        bool Init(GLenum target, GLsizeiptr frame_size);
+        void Shutdown();
+
+        // Grows every region to at least frame_size. Ranges allocated earlier in
+        // the frame are invalidated, so call it before the frame's first Allocate.
+        void Reserve(GLsizeiptr frame_size);
+
+        void BeginFrame();
+        // The returned offset is a multiple of alignment within the whole buffer
+        StreamRange Allocate(GLsizeiptr size, GLsizeiptr alignment);
+        void EndFrame();
+
+        GLuint Buffer() const { return buffer; }
+        GLenum Target() const { return target; }
+        GLsizeiptr FrameSize() const { return frameSize; }
+        GLsizeiptr Used() const { return head.load(std::memory_order_relaxed); }
+
+    private:
+        void create(GLsizeiptr frame_size);
+        void destroy();
+        void waitFor(GLsync & fence);
+
+        GLenum target = GL_ARRAY_BUFFER;
+        GLuint buffer = 0;
+        char * mapped = nullptr;
+        GLsizeiptr frameSize = 0;
+
+        int frame = 0;
+        std::atomic<GLsizeiptr> head{0};
+        std::array<GLsync, STREAM_BUFFER_FRAMES> fences{};
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/ext.hpp>
+
+// FNV-1a, so uniform names can be hashed at compile time:
+//     constexpr auto VIEW = UniformHash("view");
+constexpr std::uint32_t UniformHash(const char * name)
+{
+    std::uint32_t hash = 2166136261u;
+    while (*name)
+    {
+        hash ^= static_cast<std::uint8_t>(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Active uniforms of one program, reflected once after link. Find a slot by
+// name hash once, after Reflect, and set by slot from then on. Setters drop
+// values whose type does not match the reflected uniform, compare against the
+// last uploaded value and skip the GL call when nothing changed.
+class UniformTable
+{
+    public:
+        static constexpr int NOT_FOUND = -1;
+
+        void Reflect(GLuint program);
+
+        int Find(std::uint32_t hash) const;
+        std::size_t Size() const { return slots.size(); }
+
+        void Set(int slot, float value);
+        void Set(int slot, int value);
+        void Set(int slot, unsigned int value);
+        void Set(int slot, const glm::vec3 & value);
+        void Set(int slot, const glm::vec4 & value);
+        void Set(int slot, const glm::mat4 & value);
+
+        unsigned int Uploads() const { return uploads; }
+        unsigned int Skipped() const { return skipped; }
+        void ResetCounters() { uploads = 0; skipped = 0; }
+        // Uploads made by every table since the program started
+        static std::uint64_t TotalUploads();
+
+    private:
+        struct Slot
+        {
+            std::uint32_t hash;
+            GLint location;
+            GLenum type;
+            bool cached;
+            bool mismatchReported;
+            std::array<float, 16> value;
+        };
+
+        // False, reporting once per slot, when slot is not a uniform of type
+        bool accepts(int slot, GLenum type);
+        // True when the value differs from the cache (and updates the cache)
+        bool changed(int slot, const float * data, std::size_t count);
+
+        GLuint program = 0;
+        std::vector<Slot> slots;
+        unsigned int uploads = 0;
+        unsigned int skipped = 0;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#version 460 core
+
+layout ( local_size_x = 64 ) in;
+
+struct Instance {
+    mat4 model;
+    vec4 color;
+};
+
+struct CullData {
+    vec4 sphere;
+    uint command;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout ( std140, binding = 0 ) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+layout ( std430, binding = 0 ) writeonly buffer VisibleInstances {
+    Instance visible[];
+};
+
+layout ( std430, binding = 1 ) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout ( std430, binding = 2 ) readonly buffer Cull {
+    CullData cull[];
+};
+
+layout ( std430, binding = 3 ) buffer Commands {
+    DrawCommand commands[];
+};
+
+uniform uint instanceCount;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= instanceCount)
+        return;
+
+    Instance instance = instances[id];
+    CullData data = cull[id];
+
+    // World space sphere; the radius follows the largest axis scale
+    vec3 center = (instance.model * vec4(data.sphere.xyz, 1.0f)).xyz;
+    float scale = max(length(instance.model[0].xyz), max(length(instance.model[1].xyz), length(instance.model[2].xyz)));
+    float radius = data.sphere.w * scale;
+
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+            return;
+    }
+
+    // Compact visible instances inside the command's own instance range
+    uint slot = atomicAdd(commands[data.command].instanceCount, 1u);
+    visible[commands[data.command].baseInstance + slot] = instance;
+}
\ No newline at end of file
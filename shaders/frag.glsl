@@ -1,9 +1,9 @@
 #version 460 core
 
-uniform vec4 color;
+in vec4 vColor;
 
 out vec4 FragColor;
 
 void main() {
-    FragColor = color;
+    FragColor = vColor;
 }
\ No newline at end of file
@@ -2,10 +2,27 @@
 
 layout ( location = 0 ) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+struct Instance {
+    mat4 model;
+    vec4 color;
+};
+
+layout ( std430, binding = 0 ) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout ( std140, binding = 0 ) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 frustumPlanes[6];
+};
+
+out vec4 vColor;
 
 void main() {
-    gl_Position = model * projection * view * vec4(aPos, 1.0f);
+    Instance instance = instances[gl_BaseInstance + gl_InstanceID];
+    vColor = instance.color;
+    gl_Position = viewProjection * instance.model * vec4(aPos, 1.0f);
 }
\ No newline at end of file
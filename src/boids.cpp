@@ -0,0 +1,108 @@
+#include <boids.h>
+#include <profiler.h>
+
+#include <chrono>
+
+#include <parallel.h>
+
+#define BOIDS_MIN_RANGE 1024
+
+void BoidSystem::Init(ECS * ecs, std::shared_ptr<SpatialGridSystem> grid, std::shared_ptr<HierarchySystem> hierarchy,
+                      const BoidSettings & settings)
+{
+    this->ecs = ecs;
+    this->grid = grid;
+    this->hierarchy = hierarchy;
+    this->settings = settings;
+}
+
+void BoidSystem::Update(float dt)
+{
+    PROFILE_SCOPE("BoidSystem::Update");
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+
+    SpatialGrid const & index = grid->Grid();
+    const std::size_t count = index.Size();
+
+    velocity.resize(count);
+    nextVelocity.resize(count);
+    nextPosition.resize(count);
+
+    for (std::uint32_t slot = 0; slot < count; ++slot)
+        velocity[slot] = ecs->getComponent<Boid>(grid->EntityAt(slot)).velocity;
+
+    Clock::time_point gathered = Clock::now();
+
+    rangeNeighbours.assign(Parallel::RangeCount(count, BOIDS_MIN_RANGE), 0);
+
+    Parallel::For(count, BOIDS_MIN_RANGE, [&](std::size_t begin, std::size_t end, unsigned int range) {
+        unsigned int neighbours = 0;
+
+        for (std::size_t slot = begin; slot < end; ++slot)
+        {
+            glm::vec3 const & position = index.Position(static_cast<std::uint32_t>(slot));
+            glm::vec3 separation(0.0f), heading(0.0f), centre(0.0f);
+            int n = 0;
+
+            index.ForEachInRadius(position, settings.radius, [&](std::uint32_t other) {
+                if (other == slot)
+                    return;
+
+                glm::vec3 offset = position - index.Position(other);
+                float distanceSquared = glm::dot(offset, offset);
+                if (distanceSquared > 0.0f)
+                    separation += offset / distanceSquared;
+
+                heading += velocity[other];
+                centre += index.Position(other);
+                ++n;
+            });
+
+            glm::vec3 v = velocity[slot];
+            if (n > 0)
+            {
+                float inverse = 1.0f / n;
+                v += (separation * settings.separation +
+                      (heading * inverse - v) * settings.alignment +
+                      (centre * inverse - position) * settings.cohesion) * dt;
+            }
+
+            float speed = glm::length(v);
+            if (speed > settings.maxSpeed)
+                v *= settings.maxSpeed / speed;
+
+            glm::vec3 p = position + v * dt;
+            const float size = settings.worldHalfSize * 2.0f;
+            p.x -= size * std::floor((p.x + settings.worldHalfSize) / size);
+            p.y -= size * std::floor((p.y + settings.worldHalfSize) / size);
+
+            nextVelocity[slot] = v;
+            nextPosition[slot] = p;
+            neighbours += n;
+        }
+
+        rangeNeighbours[range] = neighbours;
+    });
+
+    Clock::time_point steered = Clock::now();
+
+    for (std::uint32_t slot = 0; slot < count; ++slot)
+    {
+        Entity entity = grid->EntityAt(slot);
+        ecs->getComponent<Boid>(entity).velocity = nextVelocity[slot];
+
+        glm::mat4 local = hierarchy->GetLocal(entity);
+        local[3] = glm::vec4(nextPosition[slot], 1.0f);
+        hierarchy->SetLocal(entity, local);
+    }
+
+    double neighbours = 0.0;
+    for (unsigned int n : rangeNeighbours)
+        neighbours += n;
+
+    stats.gatherMs = std::chrono::duration<double, std::milli>(gathered - start).count();
+    stats.steerMs = std::chrono::duration<double, std::milli>(steered - gathered).count();
+    stats.writeMs = std::chrono::duration<double, std::milli>(Clock::now() - steered).count();
+    stats.averageNeighbours = count ? neighbours / count : 0.0;
+}
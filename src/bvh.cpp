@@ -0,0 +1,721 @@
+#include <bvh.h>
+#include <profiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <hierarchy.h>
+#include <culling.h>
+
+namespace
+{
+    // False if box is wholly outside one of the planes; inside is set when it
+    // is wholly inside all of them
+    bool overlapsFrustum(const Frustum & frustum, const AABB & box, bool & inside)
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+
+        inside = true;
+        for (auto const & p : frustum.planes)
+        {
+            float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float r = std::fabs(p.x) * extents.x + std::fabs(p.y) * extents.y + std::fabs(p.z) * extents.z;
+            if (d < -r)
+                return false;
+            if (d < r)
+                inside = false;
+        }
+        return true;
+    }
+} // namespace
+
+void BVH::Build(const std::vector<AABB> & boxes)
+{
+    PROFILE_SCOPE("BVH::Build");
+    primBounds = boxes;
+    primIndices.clear();
+    primLeaf.assign(boxes.size(), -1);
+    freePrims.clear();
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+    {
+        if (boxes[i].Empty())
+            freePrims.push_back(static_cast<int>(i));
+        else
+            primIndices.push_back(static_cast<int>(i));
+    }
+    live = primIndices.size();
+
+    nodes.clear();
+    nodes.reserve(live * 2);
+    deadNodes = 0;
+
+    if (live > 0)
+    {
+        nodes.emplace_back();
+        buildNode(0, 0, static_cast<int>(live));
+    }
+
+    stats.nodes = static_cast<unsigned int>(nodes.size());
+    stats.cost = stats.buildCost = Cost();
+    ++stats.fullRebuilds;
+}
+
+int BVH::Insert(const AABB & box)
+{
+    int prim;
+    if (!freePrims.empty())
+    {
+        prim = freePrims.back();
+        freePrims.pop_back();
+        primBounds[prim] = box;
+    }
+    else
+    {
+        prim = static_cast<int>(primBounds.size());
+        primBounds.push_back(box);
+        primLeaf.push_back(-1);
+    }
+    ++live;
+    ++stats.inserts;
+
+    if (nodes.empty())
+    {
+        nodes.emplace_back();
+        nodes[0].first = static_cast<int>(primIndices.size());
+        nodes[0].count = BVH_MAX_LEAF_SIZE;
+        primIndices.insert(primIndices.end(), BVH_MAX_LEAF_SIZE, -1);
+    }
+
+    // Walk down to a leaf, always into the child whose area grows least
+    int index = 0;
+    while (nodes[index].left >= 0)
+    {
+        float growth[2];
+        int children[2] = {nodes[index].left, nodes[index].right};
+        for (int i = 0; i < 2; ++i)
+        {
+            AABB grown = nodes[children[i]].bounds;
+            grown.Grow(box);
+            growth[i] = grown.SurfaceArea() - nodes[children[i]].bounds.SurfaceArea();
+        }
+        index = growth[0] <= growth[1] ? children[0] : children[1];
+    }
+
+    int slot = -1;
+    for (int i = nodes[index].first; i < nodes[index].first + nodes[index].count && slot < 0; ++i)
+        if (primIndices[i] < 0)
+            slot = i;
+
+    if (slot < 0)
+    {
+        index = splitLeaf(index);
+        slot = nodes[index].first;
+    }
+
+    primIndices[slot] = prim;
+    primLeaf[prim] = index;
+    refitUp(index);
+    return prim;
+}
+
+void BVH::Remove(int prim)
+{
+    int leaf = primLeaf[prim];
+    Node const & node = nodes[leaf];
+    for (int i = node.first; i < node.first + node.count; ++i)
+    {
+        if (primIndices[i] == prim)
+        {
+            primIndices[i] = -1;
+            break;
+        }
+    }
+
+    primLeaf[prim] = -1;
+    primBounds[prim] = AABB();
+    freePrims.push_back(prim);
+    --live;
+    ++stats.removals;
+    refitUp(leaf);
+}
+
+void BVH::Refit(std::size_t prim, const AABB & box)
+{
+    primBounds[prim] = box;
+    refitUp(primLeaf[prim]);
+}
+
+void BVH::refitUp(int node)
+{
+    nodes[node].bounds = rangeBounds(nodes[node].first, nodes[node].count);
+    ++stats.refitNodes;
+
+    // Stop as soon as a parent's bounds come out unchanged
+    for (int parent = nodes[node].parent; parent >= 0; parent = nodes[parent].parent)
+    {
+        AABB bounds = nodes[nodes[parent].left].bounds;
+        bounds.Grow(nodes[nodes[parent].right].bounds);
+        if (bounds == nodes[parent].bounds)
+            break;
+
+        nodes[parent].bounds = bounds;
+        ++stats.refitNodes;
+    }
+}
+
+void BVH::Optimize()
+{
+    PROFILE_SCOPE("BVH::Optimize");
+    if (nodes.empty())
+        return;
+
+    stats.cost = Cost();
+    bool sparse = (primIndices.size() - live) * 2 > primIndices.size();
+    if (!sparse && stats.cost <= stats.buildCost * BVH_PARTIAL_REBUILD_RATIO)
+        return;
+
+    // Rebuilt subtrees append their nodes and orphan the old ones, so a full
+    // build also runs once half the array is garbage, or half the slots are
+    // free. Removed primitives keep their free ids.
+    if (sparse || stats.cost > stats.buildCost * BVH_FULL_REBUILD_RATIO || deadNodes * 2 > nodes.size())
+    {
+        Build(std::vector<AABB>(primBounds));
+        return;
+    }
+
+    partialRebuild(0);
+    stats.nodes = static_cast<unsigned int>(nodes.size() - deadNodes);
+    stats.cost = Cost();
+}
+
+float BVH::Cost() const
+{
+    if (nodes.empty())
+        return 0.0f;
+
+    float rootArea = nodes[0].bounds.SurfaceArea();
+    if (rootArea <= 0.0f)
+        return 0.0f;
+
+    // One unit per traversal step, one per primitive test
+    float cost = 0.0f;
+    std::vector<int> stack{0};
+    while (!stack.empty())
+    {
+        Node const & node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.left < 0)
+        {
+            int count = 0;
+            for (int i = node.first; i < node.first + node.count; ++i)
+                count += primIndices[i] >= 0;
+            cost += node.bounds.SurfaceArea() * count;
+            continue;
+        }
+
+        cost += node.bounds.SurfaceArea();
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+    return cost / rootArea;
+}
+
+void BVH::QueryFrustum(const Frustum & frustum, std::vector<int> & out) const
+{
+    if (nodes.empty())
+        return;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        int index = stack.back();
+        stack.pop_back();
+        Node const & node = nodes[index];
+
+        bool inside;
+        if (node.bounds.Empty() || !overlapsFrustum(frustum, node.bounds, inside))
+            continue;
+
+        // Fully contained subtrees are emitted without testing their children
+        if (inside)
+        {
+            collectPrims(index, out);
+            continue;
+        }
+
+        // A leaf straddling a plane tests its own primitives
+        if (node.left < 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                int prim = primIndices[i];
+                bool primInside;
+                if (prim >= 0 && overlapsFrustum(frustum, primBounds[prim], primInside))
+                    out.push_back(prim);
+            }
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void BVH::QueryAABB(const AABB & box, std::vector<int> & out) const
+{
+    if (nodes.empty())
+        return;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        Node const & node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (!node.bounds.Overlaps(box))
+            continue;
+
+        if (node.left < 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (primIndices[i] >= 0 && primBounds[primIndices[i]].Overlaps(box))
+                    out.push_back(primIndices[i]);
+            }
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+namespace
+{
+    // Slab test; returns the entry distance or FLT_MAX on a miss
+    float intersectRay(const AABB & box, const glm::vec3 & origin, const glm::vec3 & inverseDir, float maxDistance)
+    {
+        if (box.Empty())
+            return FLT_MAX;
+
+        glm::vec3 t0 = (box.min - origin) * inverseDir;
+        glm::vec3 t1 = (box.max - origin) * inverseDir;
+        glm::vec3 lo = glm::min(t0, t1);
+        glm::vec3 hi = glm::max(t0, t1);
+
+        float enter = std::max(std::max(lo.x, lo.y), std::max(lo.z, 0.0f));
+        float exit = std::min(std::min(hi.x, hi.y), std::min(hi.z, maxDistance));
+        return enter <= exit ? enter : FLT_MAX;
+    }
+}
+
+bool BVH::Raycast(const Ray & ray, float maxDistance, int & prim, float & distance) const
+{
+    if (nodes.empty())
+        return false;
+
+    // A zero component would give inf, and 0 * inf is NaN in the slab test
+    // for origins on a box plane; keep it finite and signed
+    glm::vec3 inverseDir;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float d = ray.direction[axis];
+        if (d == 0.0f)
+            d = std::signbit(d) ? -FLT_MIN : FLT_MIN;
+        inverseDir[axis] = 1.0f / d;
+    }
+    float best = maxDistance;
+    prim = -1;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    if (intersectRay(nodes[0].bounds, ray.origin, inverseDir, best) != FLT_MAX)
+        stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        Node const & node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.left < 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (primIndices[i] < 0)
+                    continue;
+                float t = intersectRay(primBounds[primIndices[i]], ray.origin, inverseDir, best);
+                if (t != FLT_MAX && (t < best || prim < 0))
+                {
+                    best = t;
+                    prim = primIndices[i];
+                }
+            }
+            continue;
+        }
+
+        // Push the far child first so the near one is visited next and
+        // tightens best before the far one is tested
+        float tLeft = intersectRay(nodes[node.left].bounds, ray.origin, inverseDir, best);
+        float tRight = intersectRay(nodes[node.right].bounds, ray.origin, inverseDir, best);
+        int nearChild = tLeft <= tRight ? node.left : node.right;
+        int farChild = tLeft <= tRight ? node.right : node.left;
+        float tNear = std::min(tLeft, tRight);
+        float tFar = std::max(tLeft, tRight);
+
+        if (tFar != FLT_MAX)
+            stack.push_back(farChild);
+        if (tNear != FLT_MAX)
+            stack.push_back(nearChild);
+    }
+
+    distance = best;
+    return prim >= 0;
+}
+
+void BVH::buildNode(int index, int first, int count)
+{
+    AABB bounds = rangeBounds(first, count);
+    {
+        Node & node = nodes[index];
+        node.bounds = bounds;
+        node.first = first;
+        node.count = count;
+        node.left = node.right = -1;
+        node.buildArea = bounds.SurfaceArea();
+    }
+
+    if (count <= BVH_MAX_LEAF_SIZE)
+    {
+        for (int i = first; i < first + count; ++i)
+            primLeaf[primIndices[i]] = index;
+        return;
+    }
+
+    AABB centroids;
+    for (int i = first; i < first + count; ++i)
+        centroids.Grow(primBounds[primIndices[i]].Center());
+
+    // Bin centroids on each axis and sweep the bin boundaries for the split
+    // with the lowest leftArea * leftCount + rightArea * rightCount
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroids.max[axis] - centroids.min[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        AABB binBounds[BVH_BINS];
+        int binCount[BVH_BINS] = {};
+        float scale = BVH_BINS / extent;
+
+        for (int i = first; i < first + count; ++i)
+        {
+            AABB const & box = primBounds[primIndices[i]];
+            int bin = std::min(BVH_BINS - 1, static_cast<int>((box.Center()[axis] - centroids.min[axis]) * scale));
+            binBounds[bin].Grow(box);
+            ++binCount[bin];
+        }
+
+        float leftArea[BVH_BINS - 1];
+        int leftCount[BVH_BINS - 1];
+        AABB sweep;
+        int sum = 0;
+        for (int i = 0; i < BVH_BINS - 1; ++i)
+        {
+            sweep.Grow(binBounds[i]);
+            sum += binCount[i];
+            leftArea[i] = sweep.SurfaceArea();
+            leftCount[i] = sum;
+        }
+
+        sweep = AABB();
+        sum = 0;
+        for (int i = BVH_BINS - 1; i > 0; --i)
+        {
+            sweep.Grow(binBounds[i]);
+            sum += binCount[i];
+
+            if (leftCount[i - 1] == 0 || sum == 0)
+                continue;
+
+            float cost = leftArea[i - 1] * leftCount[i - 1] + sweep.SurfaceArea() * sum;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    int * begin = primIndices.data() + first;
+    int * end = begin + count;
+    int * middle;
+
+    if (bestAxis < 0)
+    {
+        // Coincident centroids: any split is as good as another
+        middle = begin + count / 2;
+    }
+    else
+    {
+        float scale = BVH_BINS / (centroids.max[bestAxis] - centroids.min[bestAxis]);
+        float origin = centroids.min[bestAxis];
+        middle = std::partition(begin, end, [&](int prim) {
+            int bin = std::min(BVH_BINS - 1, static_cast<int>((primBounds[prim].Center()[bestAxis] - origin) * scale));
+            return bin < bestSplit;
+        });
+    }
+
+    int leftCount = static_cast<int>(middle - begin);
+
+    int left = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left].parent = nodes[left + 1].parent = index;
+    nodes[index].left = left;
+    nodes[index].right = left + 1;
+
+    buildNode(left, first, leftCount);
+    buildNode(left + 1, first + leftCount, count - leftCount);
+}
+
+void BVH::partialRebuild(int index)
+{
+    Node const & node = nodes[index];
+    if (node.left < 0)
+        return;
+
+    int left = node.left;
+    int right = node.right;
+
+    // Rebuild the topmost subtrees that outgrew their build-time area. Their
+    // primitives move to the end of the index array, to be built in one
+    // range; the slots they leave are garbage until the next full build.
+    if (node.bounds.SurfaceArea() > node.buildArea * BVH_NODE_GROWTH_RATIO)
+    {
+        int first = static_cast<int>(primIndices.size());
+        collectPrims(index, primIndices);
+        for (int i = first; i < static_cast<int>(primIndices.size()); ++i)
+        {
+            Node const & leaf = nodes[primLeaf[primIndices[i]]];
+            std::fill(primIndices.begin() + leaf.first, primIndices.begin() + leaf.first + leaf.count, -1);
+        }
+
+        killSubtree(left);
+        killSubtree(right);
+        buildNode(index, first, static_cast<int>(primIndices.size()) - first);
+        ++stats.partialRebuilds;
+        return;
+    }
+
+    partialRebuild(left);
+    partialRebuild(right);
+}
+
+void BVH::killSubtree(int index)
+{
+    if (nodes[index].left >= 0)
+    {
+        killSubtree(nodes[index].left);
+        killSubtree(nodes[index].right);
+    }
+    nodes[index].parent = -1;
+    ++deadNodes;
+}
+
+int BVH::splitLeaf(int leaf)
+{
+    // The full leaf moves down beside a new empty one and becomes their parent
+    Node kept = nodes[leaf];
+    kept.parent = leaf;
+    int keptIndex = static_cast<int>(nodes.size());
+    nodes.push_back(kept);
+
+    Node fresh;
+    fresh.first = static_cast<int>(primIndices.size());
+    fresh.count = BVH_MAX_LEAF_SIZE;
+    fresh.parent = leaf;
+    primIndices.insert(primIndices.end(), BVH_MAX_LEAF_SIZE, -1);
+    nodes.push_back(fresh);
+
+    for (int i = kept.first; i < kept.first + kept.count; ++i)
+        if (primIndices[i] >= 0)
+            primLeaf[primIndices[i]] = keptIndex;
+
+    nodes[leaf].left = keptIndex;
+    nodes[leaf].right = keptIndex + 1;
+    return keptIndex + 1;
+}
+
+void BVH::collectPrims(int node, std::vector<int> & out) const
+{
+    std::vector<int> stack{node};
+    while (!stack.empty())
+    {
+        Node const & current = nodes[stack.back()];
+        stack.pop_back();
+
+        if (current.left >= 0)
+        {
+            stack.push_back(current.left);
+            stack.push_back(current.right);
+            continue;
+        }
+
+        for (int i = current.first; i < current.first + current.count; ++i)
+            if (primIndices[i] >= 0)
+                out.push_back(primIndices[i]);
+    }
+}
+
+AABB BVH::rangeBounds(int first, int count) const
+{
+    AABB bounds;
+    for (int i = first; i < first + count; ++i)
+        if (primIndices[i] >= 0)
+            bounds.Grow(primBounds[primIndices[i]]);
+    return bounds;
+}
+
+void BVHSystem::Init(ECS * ecs)
+{
+    this->ecs = ecs;
+    entityPrim.assign(MAX_ENTITIES, -1);
+    rebuild = true;
+}
+
+void BVHSystem::entityAdded(Entity entity)
+{
+    if (rebuild)
+        return;
+
+    // Past a point one build is cheaper than the inserts and their refits
+    added.push_back(entity);
+    if (added.size() > tree.Size() * BVH_REBUILD_ADD_RATIO)
+    {
+        added.clear();
+        rebuild = true;
+    }
+}
+
+void BVHSystem::entityRemoved(Entity entity)
+{
+    int prim = entityPrim[entity.id()];
+    if (prim < 0)
+        return;
+
+    if (!rebuild)
+    {
+        tree.Remove(prim);
+        changed = true;
+    }
+    primEntity[prim] = -1;
+    entityPrim[entity.id()] = -1;
+}
+
+AABB BVHSystem::worldBox(Entity entity)
+{
+    glm::vec3 center, extents;
+    float radius;
+    TransformBounds(ecs->getComponent<Transform>(entity).world, ecs->getComponent<Bounds>(entity), center, radius, extents);
+
+    glm::vec3 half = extents + glm::vec3(radius);
+    AABB box;
+    box.min = center - half;
+    box.max = center + half;
+    return box;
+}
+
+void BVHSystem::Update()
+{
+    PROFILE_SCOPE("BVHSystem::Update");
+    if (rebuild)
+    {
+        boxes.clear();
+        primEntity.clear();
+        for (auto const & entity : mEntities)
+        {
+            entityPrim[entity.id()] = static_cast<int>(primEntity.size());
+            primEntity.push_back(entity.id());
+            boxes.push_back(worldBox(entity));
+        }
+
+        tree.Build(boxes);
+        added.clear();
+        rebuild = false;
+        changed = false;
+        return;
+    }
+
+    for (Entity entity : added)
+    {
+        // Entities may have left again, or joined twice, since
+        if (entityPrim[entity.id()] >= 0 || mEntities.find(entity) == mEntities.end())
+            continue;
+
+        int prim = tree.Insert(worldBox(entity));
+        if (static_cast<std::size_t>(prim) >= primEntity.size())
+            primEntity.resize(prim + 1, -1);
+        primEntity[prim] = entity.id();
+        entityPrim[entity.id()] = prim;
+        changed = true;
+    }
+    added.clear();
+
+    for (auto const & entity : mEntities)
+    {
+        int prim = entityPrim[entity.id()];
+        AABB box = worldBox(entity);
+        if (box != tree.PrimBounds(prim))
+        {
+            tree.Refit(prim, box);
+            changed = true;
+        }
+    }
+
+    // Updates only run on demand, so drift is bounded per update rather than
+    // per so many of them
+    if (changed)
+    {
+        tree.Optimize();
+        changed = false;
+    }
+}
+
+void BVHSystem::QueryFrustum(const Frustum & frustum, std::vector<Entity> & out) const
+{
+    hits.clear();
+    tree.QueryFrustum(frustum, hits);
+    for (int prim : hits)
+        out.push_back(Entity(primEntity[prim]));
+}
+
+void BVHSystem::QueryAABB(const AABB & box, std::vector<Entity> & out) const
+{
+    hits.clear();
+    tree.QueryAABB(box, hits);
+    for (int prim : hits)
+        out.push_back(Entity(primEntity[prim]));
+}
+
+bool BVHSystem::Raycast(const Ray & ray, float maxDistance, Entity & entity, float & distance) const
+{
+    int prim;
+    if (!tree.Raycast(ray, maxDistance, prim, distance))
+        return false;
+
+    entity = Entity(primEntity[prim]);
+    return true;
+}
@@ -0,0 +1,232 @@
+#include <culling.h>
+#include <profiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <hierarchy.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CULLING_X86 1
+#endif
+
+void TransformBounds(const glm::mat4 & world, const Bounds & local, glm::vec3 & center, float & radius, glm::vec3 & extents)
+{
+    glm::vec3 axisX(world[0]), axisY(world[1]), axisZ(world[2]);
+    float scale = std::max(glm::length(axisX), std::max(glm::length(axisY), glm::length(axisZ)));
+
+    center = glm::vec3(world * glm::vec4(local.center, 1.0f));
+    radius = local.radius * scale;
+    extents = glm::abs(axisX) * local.extents.x + glm::abs(axisY) * local.extents.y + glm::abs(axisZ) * local.extents.z;
+}
+
+void BoundsSoA::Resize(std::size_t count)
+{
+    for (auto * lane : {&centerX, &centerY, &centerZ, &radius, &extentX, &extentY, &extentZ})
+        lane->resize(count);
+}
+
+void BoundsSoA::Set(std::size_t i, const glm::vec3 & center, float r, const glm::vec3 & extents)
+{
+    centerX[i] = center.x;
+    centerY[i] = center.y;
+    centerZ[i] = center.z;
+    radius[i] = r;
+    extentX[i] = extents.x;
+    extentY[i] = extents.y;
+    extentZ[i] = extents.z;
+}
+
+namespace Culling
+{
+    namespace
+    {
+        // A lane is outside when its center lies further than its projected
+        // size behind any plane: dot(n, c) + w < -(r + dot(|n|, e))
+        bool testScalar(const Frustum & frustum, const BoundsSoA & b, std::size_t i)
+        {
+            for (auto const & p : frustum.planes)
+            {
+                float d = p.x * b.centerX[i] + p.y * b.centerY[i] + p.z * b.centerZ[i] + p.w;
+                float r = b.radius[i] + std::fabs(p.x) * b.extentX[i] + std::fabs(p.y) * b.extentY[i] + std::fabs(p.z) * b.extentZ[i];
+                if (d < -r)
+                    return false;
+            }
+            return true;
+        }
+
+        std::size_t cullScalar(const Frustum & frustum, const BoundsSoA & b, std::size_t begin, std::uint8_t * visible)
+        {
+            std::size_t count = 0;
+            for (std::size_t i = begin; i < b.Size(); ++i)
+            {
+                visible[i] = testScalar(frustum, b, i);
+                count += visible[i];
+            }
+            return count;
+        }
+
+#ifdef CULLING_X86
+        __attribute__((target("sse2")))
+        std::size_t cullSSE(const Frustum & frustum, const BoundsSoA & b, std::uint8_t * visible)
+        {
+            const std::size_t n = b.Size();
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            std::size_t count = 0;
+            std::size_t i = 0;
+
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 cx = _mm_loadu_ps(&b.centerX[i]);
+                __m128 cy = _mm_loadu_ps(&b.centerY[i]);
+                __m128 cz = _mm_loadu_ps(&b.centerZ[i]);
+                __m128 r = _mm_loadu_ps(&b.radius[i]);
+                __m128 ex = _mm_loadu_ps(&b.extentX[i]);
+                __m128 ey = _mm_loadu_ps(&b.extentY[i]);
+                __m128 ez = _mm_loadu_ps(&b.extentZ[i]);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (auto const & p : frustum.planes)
+                {
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx), _mm_mul_ps(_mm_set1_ps(p.y), cy)), _mm_mul_ps(_mm_set1_ps(p.z), cz)), _mm_set1_ps(p.w));
+                    __m128 size = _mm_add_ps(_mm_add_ps(_mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(std::fabs(p.x)), ex)), _mm_mul_ps(_mm_set1_ps(std::fabs(p.y)), ey)), _mm_mul_ps(_mm_set1_ps(std::fabs(p.z)), ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_xor_ps(size, sign)));
+                }
+
+                int mask = _mm_movemask_ps(inside);
+                for (int lane = 0; lane < 4; ++lane)
+                    visible[i + lane] = (mask >> lane) & 1;
+                count += __builtin_popcount(mask);
+            }
+
+            return count + cullScalar(frustum, b, i, visible);
+        }
+
+        __attribute__((target("avx")))
+        std::size_t cullAVX(const Frustum & frustum, const BoundsSoA & b, std::uint8_t * visible)
+        {
+            const std::size_t n = b.Size();
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            std::size_t count = 0;
+            std::size_t i = 0;
+
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 cx = _mm256_loadu_ps(&b.centerX[i]);
+                __m256 cy = _mm256_loadu_ps(&b.centerY[i]);
+                __m256 cz = _mm256_loadu_ps(&b.centerZ[i]);
+                __m256 r = _mm256_loadu_ps(&b.radius[i]);
+                __m256 ex = _mm256_loadu_ps(&b.extentX[i]);
+                __m256 ey = _mm256_loadu_ps(&b.extentY[i]);
+                __m256 ez = _mm256_loadu_ps(&b.extentZ[i]);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (auto const & p : frustum.planes)
+                {
+                    __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), cx), _mm256_mul_ps(_mm256_set1_ps(p.y), cy)), _mm256_mul_ps(_mm256_set1_ps(p.z), cz)), _mm256_set1_ps(p.w));
+                    __m256 size = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(std::fabs(p.x)), ex)), _mm256_mul_ps(_mm256_set1_ps(std::fabs(p.y)), ey)), _mm256_mul_ps(_mm256_set1_ps(std::fabs(p.z)), ez));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_xor_ps(size, sign), _CMP_GE_OQ));
+                }
+
+                int mask = _mm256_movemask_ps(inside);
+                for (int lane = 0; lane < 8; ++lane)
+                    visible[i + lane] = (mask >> lane) & 1;
+                count += __builtin_popcount(mask);
+            }
+
+            return count + cullScalar(frustum, b, i, visible);
+        }
+#endif
+    } // namespace
+
+    Kernel BestKernel()
+    {
+#ifdef CULLING_X86
+        if (__builtin_cpu_supports("avx"))
+            return Kernel::AVX;
+        if (__builtin_cpu_supports("sse2"))
+            return Kernel::SSE;
+#endif
+        return Kernel::Scalar;
+    }
+
+    const char * KernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::AVX:
+            return "avx";
+        case Kernel::SSE:
+            return "sse";
+        default:
+            return "scalar";
+        }
+    }
+
+    std::size_t CullBounds(const Frustum & frustum, const BoundsSoA & bounds, std::uint8_t * visible, Kernel kernel)
+    {
+#ifdef CULLING_X86
+        if (kernel == Kernel::AVX)
+            return cullAVX(frustum, bounds, visible);
+        if (kernel == Kernel::SSE)
+            return cullSSE(frustum, bounds, visible);
+#endif
+        return cullScalar(frustum, bounds, 0, visible);
+    }
+} // namespace Culling
+
+void CullingSystem::Init(ECS * ecs)
+{
+    this->ecs = ecs;
+    kernel = Culling::BestKernel();
+    entityVisible.assign(MAX_ENTITIES, 0);
+}
+
+void CullingSystem::Update(const Frustum & frustum)
+{
+    PROFILE_SCOPE("CullingSystem::Update");
+    using Clock = std::chrono::steady_clock;
+    stats = CullingStats{};
+
+    // Gather world-space bounds into SoA lanes
+    Clock::time_point start = Clock::now();
+
+    std::size_t count = mEntities.size();
+    worldBounds.Resize(count);
+    laneEntity.resize(count);
+    laneVisible.resize(count);
+
+    std::size_t lane = 0;
+    for (auto const & entity : mEntities)
+    {
+        glm::vec3 center, extents;
+        float radius;
+        TransformBounds(ecs->getComponent<Transform>(entity).world, ecs->getComponent<Bounds>(entity), center, radius, extents);
+
+        worldBounds.Set(lane, center, radius, extents);
+        laneEntity[lane] = entity.id();
+        ++lane;
+    }
+
+    Clock::time_point gathered = Clock::now();
+
+    std::size_t visibleCount = Culling::CullBounds(frustum, worldBounds, laneVisible.data(), kernel);
+
+    Clock::time_point tested = Clock::now();
+
+    visible.clear();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        entityVisible[laneEntity[i]] = laneVisible[i];
+        if (laneVisible[i])
+            visible.push_back(Entity(laneEntity[i]));
+    }
+
+    stats.tested = static_cast<unsigned int>(count);
+    stats.visible = static_cast<unsigned int>(visibleCount);
+    stats.culled = stats.tested - stats.visible;
+    stats.gatherMs = std::chrono::duration<double, std::milli>(gathered - start).count();
+    stats.testMs = std::chrono::duration<double, std::milli>(tested - gathered).count();
+}
@@ -0,0 +1,34 @@
+#include <cycle_clock.h>
+
+#include <thread>
+
+namespace CycleClock
+{
+    namespace
+    {
+        double calibrate()
+        {
+#ifdef CYCLE_CLOCK_TSC
+            using Clock = std::chrono::steady_clock;
+
+            Clock::time_point start = Clock::now();
+            std::uint64_t startTicks = Now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::uint64_t endTicks = Now();
+            Clock::time_point end = Clock::now();
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            return endTicks > startTicks ? ns / static_cast<double>(endTicks - startTicks) : 1.0;
+#else
+            using Period = std::chrono::steady_clock::period;
+            return 1e9 * Period::num / Period::den;
+#endif
+        }
+    } // namespace
+
+    double NanosecondsPerTick()
+    {
+        static const double nanoseconds_per_tick = calibrate();
+        return nanoseconds_per_tick;
+    }
+}
@@ -0,0 +1,121 @@
+#include <frame_pacer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+    // Weight of the newest sleep in the running estimate
+    constexpr double SLEEP_ESTIMATE_WEIGHT = 0.05;
+
+    double toMs(FramePacer::Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+} // namespace
+
+void FramePacer::SetTargetRate(double hz)
+{
+    targetRate = hz > 0.0 ? hz : 0.0;
+    period = targetRate > 0.0
+                 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetRate))
+                 : Clock::duration::zero();
+}
+
+void FramePacer::Reset()
+{
+    lastFrame = Clock::now();
+    deadline = lastFrame;
+}
+
+double FramePacer::BeginFrame()
+{
+    Clock::time_point now = Clock::now();
+    double ms = toMs(now - lastFrame);
+    lastFrame = now;
+
+    ++frames;
+    double delta = ms - mean;
+    mean += delta / frames;
+    m2 += delta * (ms - mean);
+
+    if (targetRate > 0.0)
+    {
+        double target = toMs(period);
+        maxDeviation = std::max(maxDeviation, std::abs(ms - target));
+        if (ms > target * (1.0 + FRAME_PACER_LATE_TOLERANCE))
+            ++lateFrames;
+    }
+
+    return ms / 1000.0;
+}
+
+void FramePacer::Wait()
+{
+    if (period == Clock::duration::zero())
+        return;
+
+    deadline += period;
+
+    // More than a frame behind: start over rather than rush
+    Clock::time_point now = Clock::now();
+    if (now > deadline + period)
+    {
+        deadline = now;
+        return;
+    }
+
+    sleepUntil(deadline);
+}
+
+void FramePacer::sleepUntil(Clock::time_point until)
+{
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    // Sleep while even a slow 1 ms sleep would wake up in time
+    for (;;)
+    {
+        double remaining = Milliseconds(until - Clock::now()).count();
+        double estimate = sleepMean + std::sqrt(sleepVariance);
+        if (remaining <= estimate)
+            break;
+
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        observeSleep(toMs(Clock::now() - start));
+    }
+
+    // Spin out the rest
+    while (Clock::now() < until)
+        std::this_thread::yield();
+}
+
+void FramePacer::observeSleep(double ms)
+{
+    double delta = ms - sleepMean;
+    sleepMean += SLEEP_ESTIMATE_WEIGHT * delta;
+    sleepVariance = (1.0 - SLEEP_ESTIMATE_WEIGHT) * (sleepVariance + SLEEP_ESTIMATE_WEIGHT * delta * delta);
+}
+
+FramePacerStats FramePacer::Stats() const
+{
+    FramePacerStats stats;
+    stats.frames = frames;
+    stats.targetMs = targetRate > 0.0 ? toMs(period) : 0.0;
+    stats.meanMs = mean;
+    stats.jitterMs = frames > 1 ? std::sqrt(m2 / (frames - 1)) : 0.0;
+    stats.maxDeviationMs = maxDeviation;
+    stats.lateFrames = lateFrames;
+    stats.sleepEstimateMs = sleepMean + std::sqrt(sleepVariance);
+    return stats;
+}
+
+void FramePacer::ResetStats()
+{
+    frames = 0;
+    mean = 0.0;
+    m2 = 0.0;
+    maxDeviation = 0.0;
+    lateFrames = 0;
+}
@@ -0,0 +1,353 @@
+#include <frame_stats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+
+namespace
+{
+    int highestBit(std::uint64_t value)
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        int bit = 0;
+        while (value >>= 1)
+            ++bit;
+        return bit;
+#endif
+    }
+
+    struct RenderCounter
+    {
+        const char * name;
+        std::uint64_t FrameRenderCounts::*value;
+    };
+
+    const RenderCounter render_counters[] = {
+        {"draw_calls", &FrameRenderCounts::drawCalls},
+        {"instances", &FrameRenderCounts::instances},
+        {"triangles", &FrameRenderCounts::triangles},
+        {"program_binds", &FrameRenderCounts::programBinds},
+        {"vao_binds", &FrameRenderCounts::vaoBinds},
+        {"texture_binds", &FrameRenderCounts::textureBinds},
+        {"buffer_binds", &FrameRenderCounts::bufferBinds},
+        {"elided_calls", &FrameRenderCounts::elidedCalls},
+        {"uniform_uploads", &FrameRenderCounts::uniformUploads},
+        {"bytes_uploaded", &FrameRenderCounts::bytesUploaded},
+        {"cull_visible", &FrameRenderCounts::cullVisible},
+        {"cull_culled", &FrameRenderCounts::cullCulled},
+        {"cull_gather_us", &FrameRenderCounts::cullGatherUs},
+        {"cull_test_us", &FrameRenderCounts::cullTestUs}};
+
+    double meanPerFrame(const FrameStatsWindow & window, const RenderCounter & counter)
+    {
+        return window.frames ? static_cast<double>(window.renderTotal.*counter.value) / window.frames : 0.0;
+    }
+
+    FrameTimeSummary summarize(const FrameHistogram & histogram)
+    {
+        FrameTimeSummary summary;
+        summary.meanMs = histogram.MeanMs();
+        summary.p50Ms = histogram.PercentileMs(50.0);
+        summary.p95Ms = histogram.PercentileMs(95.0);
+        summary.p99Ms = histogram.PercentileMs(99.0);
+        summary.maxMs = histogram.MaxMs();
+        return summary;
+    }
+
+    void writeSummaryCSV(std::FILE * file, const FrameTimeSummary & summary)
+    {
+        std::fprintf(file, ",%.3f,%.3f,%.3f,%.3f,%.3f", summary.meanMs, summary.p50Ms, summary.p95Ms,
+                     summary.p99Ms, summary.maxMs);
+    }
+
+    void writeWindowCSV(std::FILE * file, const char * label, const FrameStatsWindow & window)
+    {
+        std::fprintf(file, "%s,%.3f,%.3f,%llu,%llu,%llu", label, window.startSeconds, window.seconds,
+                     static_cast<unsigned long long>(window.frames), static_cast<unsigned long long>(window.steps),
+                     static_cast<unsigned long long>(window.hitches));
+        writeSummaryCSV(file, window.frame);
+        writeSummaryCSV(file, window.update);
+        writeSummaryCSV(file, window.render);
+        for (auto const & counter : render_counters)
+            std::fprintf(file, ",%.1f,%llu", meanPerFrame(window, counter),
+                         static_cast<unsigned long long>(window.renderMax.*counter.value));
+        std::fputc('\n', file);
+    }
+
+    void writeSummaryJSON(std::FILE * file, const char * name, const FrameTimeSummary & summary)
+    {
+        std::fprintf(file, "\"%s\":{\"mean_ms\":%.3f,\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}",
+                     name, summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs);
+    }
+
+    void writeWindowJSON(std::FILE * file, const FrameStatsWindow & window)
+    {
+        std::fprintf(file, "{\"start_s\":%.3f,\"seconds\":%.3f,\"frames\":%llu,\"steps\":%llu,\"hitches\":%llu,",
+                     window.startSeconds, window.seconds, static_cast<unsigned long long>(window.frames),
+                     static_cast<unsigned long long>(window.steps), static_cast<unsigned long long>(window.hitches));
+        writeSummaryJSON(file, "frame", window.frame);
+        std::fputc(',', file);
+        writeSummaryJSON(file, "update", window.update);
+        std::fputc(',', file);
+        writeSummaryJSON(file, "render", window.render);
+        std::fputs(",\"render_counts\":{", file);
+        for (auto const & counter : render_counters)
+        {
+            std::fprintf(file, "%s\"%s\":{\"mean\":%.1f,\"max\":%llu}", &counter == render_counters ? "" : ",",
+                         counter.name, meanPerFrame(window, counter),
+                         static_cast<unsigned long long>(window.renderMax.*counter.value));
+        }
+        std::fputs("}}", file);
+    }
+} // namespace
+
+std::size_t FrameHistogram::bucketOf(std::uint64_t us)
+{
+    if (us < SUB_COUNT)
+        return static_cast<std::size_t>(us);
+
+    // Keep the top SUB_BITS bits: the leading one selects the power of two,
+    // the rest the linear bucket within it
+    int shift = highestBit(us) - (FRAME_HISTOGRAM_SUB_BITS - 1);
+    std::size_t bucket = SUB_COUNT + (shift - 1) * HALF_COUNT + static_cast<std::size_t>((us >> shift) - HALF_COUNT);
+    return std::min(bucket, BUCKETS - 1);
+}
+
+std::uint64_t FrameHistogram::upperBound(std::size_t bucket)
+{
+    if (bucket < SUB_COUNT)
+        return bucket;
+
+    std::size_t offset = bucket - SUB_COUNT;
+    int shift = static_cast<int>(offset / HALF_COUNT) + 1;
+    std::uint64_t sub = offset % HALF_COUNT + HALF_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void FrameHistogram::Record(double ms)
+{
+    ms = std::max(ms, 0.0);
+    ++buckets[bucketOf(static_cast<std::uint64_t>(ms * 1000.0 + 0.5))];
+    ++count;
+    sumMs += ms;
+    maxMs = std::max(maxMs, ms);
+}
+
+void FrameHistogram::Merge(const FrameHistogram & other)
+{
+    for (std::size_t i = 0; i < BUCKETS; ++i)
+        buckets[i] += other.buckets[i];
+    count += other.count;
+    sumMs += other.sumMs;
+    maxMs = std::max(maxMs, other.maxMs);
+}
+
+void FrameHistogram::Reset()
+{
+    std::memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    sumMs = 0.0;
+    maxMs = 0.0;
+}
+
+double FrameHistogram::PercentileMs(double p) const
+{
+    if (count == 0)
+        return 0.0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * count));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(upperBound(i) / 1000.0, maxMs);
+    }
+    return maxMs;
+}
+
+void FrameStats::Series::Reset()
+{
+    frame.Reset();
+    update.Reset();
+    render.Reset();
+    steps = 0;
+    hitches = 0;
+    seconds = 0.0;
+    renderTotal = FrameRenderCounts{};
+    renderMax = FrameRenderCounts{};
+}
+
+FrameStatsWindow FrameStats::Series::Summarize(double start_seconds) const
+{
+    FrameStatsWindow window;
+    window.startSeconds = start_seconds;
+    window.seconds = seconds;
+    window.frames = frame.Count();
+    window.steps = steps;
+    window.hitches = hitches;
+    window.frame = summarize(frame);
+    window.update = summarize(update);
+    window.render = summarize(render);
+    window.renderTotal = renderTotal;
+    window.renderMax = renderMax;
+    return window;
+}
+
+void FrameStats::Init(double window_seconds, std::size_t max_windows)
+{
+    windowSeconds = window_seconds > 0.0 ? window_seconds : FRAME_STATS_WINDOW_SECONDS;
+    windows.assign(std::max<std::size_t>(max_windows, 1), FrameStatsWindow{});
+    Reset();
+}
+
+void FrameStats::Reset()
+{
+    session.Reset();
+    current.Reset();
+    for (auto & system : systems)
+    {
+        system.ms.Reset();
+        system.pendingTicks = 0;
+    }
+    currentStart = 0.0;
+    windowHead = 0;
+    windowCount = 0;
+}
+
+void FrameStats::RecordFrame(double frame_ms, double update_ms, double render_ms, int steps,
+                             const FrameRenderCounts & counts)
+{
+    bool hitch = hitchMs > 0.0 && frame_ms > hitchMs;
+    for (Series * series : {&session, &current})
+    {
+        series->frame.Record(frame_ms);
+        series->update.Record(update_ms);
+        series->render.Record(render_ms);
+        series->steps += steps;
+        series->hitches += hitch;
+        series->seconds += frame_ms / 1000.0;
+        for (auto const & counter : render_counters)
+        {
+            series->renderTotal.*counter.value += counts.*counter.value;
+            series->renderMax.*counter.value = std::max(series->renderMax.*counter.value, counts.*counter.value);
+        }
+    }
+
+    for (auto & system : systems)
+    {
+        system.ms.Record(CycleClock::ToNanoseconds(system.pendingTicks) * 1e-6);
+        system.pendingTicks = 0;
+    }
+
+    if (current.seconds >= windowSeconds)
+        closeWindow();
+}
+
+int FrameStats::AddSystem(const char * name)
+{
+    systems.emplace_back();
+    systems.back().name = name;
+    return static_cast<int>(systems.size() - 1);
+}
+
+FrameTimeSummary FrameStats::SystemSession(std::size_t index) const
+{
+    return summarize(systems[index].ms);
+}
+
+void FrameStats::closeWindow()
+{
+    if (!windows.empty())
+    {
+        windows[windowHead] = current.Summarize(currentStart);
+        windowHead = (windowHead + 1) % windows.size();
+        windowCount = std::min(windowCount + 1, windows.size());
+    }
+
+    currentStart += current.seconds;
+    current.Reset();
+}
+
+FrameStatsWindow FrameStats::Session() const
+{
+    return session.Summarize(0.0);
+}
+
+const FrameStatsWindow & FrameStats::Window(std::size_t index) const
+{
+    std::size_t oldest = (windowHead + windows.size() - windowCount) % windows.size();
+    return windows[(oldest + index) % windows.size()];
+}
+
+bool FrameStats::Dump(const std::string & path) const
+{
+    std::FILE * file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    bool written = json ? dumpJSON(file) : dumpCSV(file);
+    return std::fclose(file) == 0 && written;
+}
+
+bool FrameStats::dumpCSV(std::FILE * file) const
+{
+    std::fputs("window,start_s,seconds,frames,steps,hitches", file);
+    for (const char * series : {"frame", "update", "render"})
+        std::fprintf(file, ",%s_mean_ms,%s_p50_ms,%s_p95_ms,%s_p99_ms,%s_max_ms", series, series, series, series, series);
+    for (auto const & counter : render_counters)
+        std::fprintf(file, ",%s_mean,%s_max", counter.name, counter.name);
+    std::fputc('\n', file);
+
+    char label[32];
+    for (std::size_t i = 0; i < windowCount; ++i)
+    {
+        std::snprintf(label, sizeof(label), "%zu", i);
+        writeWindowCSV(file, label, Window(i));
+    }
+    writeWindowCSV(file, "session", Session());
+
+    if (!systems.empty())
+    {
+        std::fputs("\nsystem,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n", file);
+        for (auto const & system : systems)
+        {
+            std::fputs(system.name, file);
+            writeSummaryCSV(file, summarize(system.ms));
+            std::fputc('\n', file);
+        }
+    }
+
+    return !std::ferror(file);
+}
+
+bool FrameStats::dumpJSON(std::FILE * file) const
+{
+    std::fputs("{\"session\":", file);
+    writeWindowJSON(file, Session());
+    std::fputs(",\"systems\":{", file);
+    for (std::size_t i = 0; i < systems.size(); ++i)
+    {
+        if (i)
+            std::fputc(',', file);
+        writeSummaryJSON(file, systems[i].name, summarize(systems[i].ms));
+    }
+    std::fputc('}', file);
+    std::fprintf(file, ",\"window_seconds\":%.3f,\"windows\":[", windowSeconds);
+    for (std::size_t i = 0; i < windowCount; ++i)
+    {
+        if (i)
+            std::fputc(',', file);
+        std::fputc('\n', file);
+        writeWindowJSON(file, Window(i));
+    }
+    std::fputs("]}\n", file);
+
+    return !std::ferror(file);
+}
@@ -1,14 +1,81 @@
 #include <game.h>
+#include <log.h>
+#include <profiler.h>
+#include <cycle_clock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
 
 struct Renderable
 {
-    GLuint VAO;
-    GLuint VBO;
-    GLuint EBO;
-    GLuint shaderProgram;
-    glm::mat4 model;
+    ResourceLoader::MeshHandle mesh;
+    ResourceLoader::ShaderHandle shader;
+    glm::vec4 color;
 };
 
+namespace
+{
+    // Set by SIGINT/SIGTERM, which otherwise end a headless run without a report
+    volatile std::sig_atomic_t interrupted = 0;
+
+    // Set by SIGUSR1 to write frame statistics and the trace without stopping
+    volatile std::sig_atomic_t dumpRequested = 0;
+
+    void onInterrupt(int)
+    {
+        interrupted = 1;
+    }
+
+    void onDumpRequest(int)
+    {
+        dumpRequested = 1;
+    }
+
+    double ticksToMs(std::uint64_t ticks)
+    {
+        return CycleClock::ToNanoseconds(ticks) * 1e-6;
+    }
+
+    // Position of the index-th of count items on a square grid centred on
+    // the origin, spacing apart
+    glm::vec3 gridPosition(std::size_t index, std::size_t count, float spacing)
+    {
+        std::size_t side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        float offset = (side - 1) * spacing * 0.5f;
+        return glm::vec3((index % side) * spacing - offset, (index / side) * spacing - offset, 0.0f);
+    }
+
+    // Camera on +Z that sees a square of halfExtent around the origin
+    void frame(Camera & camera, float halfExtent)
+    {
+        float distance = halfExtent / std::tan(glm::radians(22.5f)) * 1.1f;
+        camera.LookAt(glm::vec3(0.0f, 0.0f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        camera.SetPerspective(glm::radians(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, distance * 2.0f);
+    }
+
+    FrameRenderCounts renderCounts(const RenderStats & stats, const CullingStats & culling)
+    {
+        FrameRenderCounts counts;
+        counts.drawCalls = stats.drawCalls;
+        counts.instances = stats.instances;
+        counts.triangles = stats.triangles;
+        counts.programBinds = stats.programBinds;
+        counts.vaoBinds = stats.vaoBinds;
+        counts.textureBinds = stats.textureBinds;
+        counts.bufferBinds = stats.bufferBinds;
+        counts.elidedCalls = stats.elidedCalls;
+        counts.uniformUploads = stats.uniformUploads;
+        counts.bytesUploaded = stats.bytesUploaded;
+        counts.cullVisible = culling.visible;
+        counts.cullCulled = culling.culled;
+        counts.cullGatherUs = static_cast<std::uint64_t>(culling.gatherMs * 1000.0);
+        counts.cullTestUs = static_cast<std::uint64_t>(culling.testMs * 1000.0);
+        return counts;
+    }
+} // namespace
+
 Game & Game::Instance()
 {
     static Game game;
@@ -44,7 +111,7 @@ bool Game::initGLAD()
     return !gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress);
 }
 
-bool Game::init()
+bool Game::initDisplay()
 {
     bool success = true;
 
@@ -52,41 +119,123 @@ bool Game::init()
 
     if (initSDL())
     {
-        std::cout << "SDL failed to init: " << SDL_GetError() << std::endl;
+        LOG_ERROR("SDL failed to init: {}", SDL_GetError());
         success = false;
     }
 
     if (createWindow())
     {
-        std::cout << "Window failed to create: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Window failed to create: {}", SDL_GetError());
         success = false;
     }
 
     if (createGLContext())
     {
-        std::cout << "Context creation failed: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Context creation failed: {}", SDL_GetError());
         success = false;
     }
 
     if (initGLAD())
     {
-        std::cout << "GLAD failed to init" << glGetError() << std::endl;
+        LOG_ERROR("GLAD failed to init {}", glGetError());
         success = false;
     }
 
+    SetSwapInterval(config.swapInterval);
+
+    return success;
+}
+
+bool Game::init()
+{
+    bool success = true;
+
+    // Headless runs never touch SDL or GL; assets and state go to a device
+    // that only records them. So do frames rendered to a recording device.
+    if (config.headless || config.recordingDevice)
+        RenderDevice::SetCurrent(&nullDevice);
+    else
+        success = initDisplay();
+
     Running = true;
 
     std::fill_n(Keys, MAX_KEYS_LENGTH, false);
 
     SetClearColor(glm::vec4(0.6f, 0.0f, 0.6f, 1.0f));
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    if (!config.headless)
+    {
+        renderer.SetGpuCulling(config.gpuCulling);
+        renderer.SetCullingCrossCheck(config.cullCrossCheck);
+        renderer.Init();
+        if (config.cullCrossCheck && !renderer.GpuCulling())
+            LOG_WARN("This device cannot run GPU culling; nothing to cross-check");
+    }
 
     ecs.init();
     ecs.registerComponent<Renderable>();
+    ecs.registerComponent<Transform>();
+    ecs.registerComponent<Parent>();
+    ecs.registerComponent<Children>();
+    ecs.registerComponent<Camera>();
+    ecs.registerComponent<Bounds>();
+    ecs.registerComponent<Boid>();
+
+    hierarchy = ecs.registerSystem<HierarchySystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        ecs.setSystemSignature<HierarchySystem>(signature);
+    }
+    hierarchy->Init(&ecs);
+
+    culling = ecs.registerSystem<CullingSystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        signature.set(ecs.getComponentType<Bounds>());
+        ecs.setSystemSignature<CullingSystem>(signature);
+    }
+    culling->Init(&ecs);
+
+    spatial = ecs.registerSystem<BVHSystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        signature.set(ecs.getComponentType<Bounds>());
+        ecs.setSystemSignature<BVHSystem>(signature);
+    }
+    spatial->Init(&ecs);
 
-    Entity square = ecs.createEntity();
-    createSquare(square);
+    grid = ecs.registerSystem<SpatialGridSystem>();
+    boids = ecs.registerSystem<BoidSystem>();
+    {
+        Signature signature;
+        signature.set(ecs.getComponentType<Transform>());
+        signature.set(ecs.getComponentType<Boid>());
+        ecs.setSystemSignature<SpatialGridSystem>(signature);
+        ecs.setSystemSignature<BoidSystem>(signature);
+    }
+    BoidSettings boidSettings;
+    grid->Init(&ecs, boidSettings.radius);
+    boids->Init(&ecs, grid, hierarchy, boidSettings);
+
+    camera = ecs.createEntity();
+    {
+        Camera cam;
+        cam.LookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        cam.SetPerspective(glm::radians(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+        ecs.addComponent(camera, cam);
+    }
+
+    // Benchmark scenes bring their own entities
+    if (config.benchScene.empty())
+    {
+        Entity square = ecs.createEntity();
+        createSquare(square);
+    }
 
     return success;
 }
@@ -99,7 +248,46 @@ void Game::SetWindowTitle(const char *window_title)
 void Game::SetClearColor(glm::vec4 color)
 {
     clearColor = color;
-    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    RenderDevice::Current().ClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+}
+
+bool Game::SetSwapInterval(int interval)
+{
+    if (SDL_GL_SetSwapInterval(interval) == 0)
+        return true;
+
+    // Adaptive vsync needs EXT_swap_control_tear
+    if (interval < 0 && SDL_GL_SetSwapInterval(1) == 0)
+    {
+        LOG_WARN("Adaptive vsync unsupported, using vsync");
+        return true;
+    }
+
+    LOG_WARN("Swap interval {} failed: {}", interval, SDL_GetError());
+    return false;
+}
+
+Entity Game::Pick(int x, int y)
+{
+    Camera & cam = ecs.getComponent<Camera>(camera);
+    glm::mat4 inverse = glm::inverse(cam.viewProjection);
+
+    float ndcX = 2.0f * x / WINDOW_WIDTH - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / WINDOW_HEIGHT;
+    glm::vec4 near = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 far = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+    Ray ray;
+    ray.origin = glm::vec3(near) / near.w;
+    ray.direction = glm::vec3(far) / far.w - ray.origin;
+
+    // The BVH is only brought up to date when it is asked something
+    spatial->Update();
+
+    Entity entity(-1);
+    float distance;
+    spatial->Raycast(ray, 1.0f, entity, distance);
+    return entity;
 }
 
 void Game::createSquare(Entity entity)
@@ -118,43 +306,27 @@ void Game::createSquare(Entity entity)
         0, 1, 3,
         1, 2, 3};
 
-    // Generate and bind VAO
-    glGenVertexArrays(1, &renderable.VAO);
-    glBindVertexArray(renderable.VAO);
-
-    // Generate and bind VBO
-    glGenBuffers(1, &renderable.VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, renderable.VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Meshes and shaders are shared through the asset cache, so only the
+    // first square uploads geometry and compiles the program
+    renderable.mesh = ResourceLoader::LoadMesh("square", vertices, sizeof(vertices), indices, 6);
+    renderable.shader = ResourceLoader::LoadShader("shaders/vert.glsl", "shaders/frag.glsl");
 
-    // Generate and bind EBO
-    glGenBuffers(1, &renderable.EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderable.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    renderable.color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
 
-    // Set vertex attribute pointers
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
+    glm::vec4 sphere = renderable.mesh.Get().bounds;
 
-    // Load shaders
-    renderable.shaderProgram = ResourceLoader::LoadShaderGL("shaders/vert.glsl", "shaders/frag.glsl");
-
-    // Set up model matrix
-    renderable.model = glm::mat4(1.0f);
-
-    // Add component to entity
+    // Add components to entity
     ecs.addComponent(entity, renderable);
-}
-
-float Game::calculateDeltaTime(unsigned int NOW, unsigned int &LAST)
-{
-    float deltaTime = (float)(NOW - LAST) / SDL_GetPerformanceFrequency();
-    LAST = NOW;
-    return deltaTime;
+    ecs.addComponent(entity, Transform{});
+    ecs.addComponent(entity, Bounds::Sphere(glm::vec3(sphere), sphere.w));
 }
 
 void Game::pollEvents()
 {
+    PROFILE_SCOPE("Game::pollEvents");
+    if (!window)
+        return;
+
     while (SDL_PollEvent(&Event))
     {
         switch (Event.type)
@@ -162,44 +334,81 @@ void Game::pollEvents()
         case SDL_QUIT:
             Running = false;
             break;
-        case SDL_KEYDOWN:
-            Keys[Event.key.keysym.sym] = true;
+        case SDL_MOUSEBUTTONDOWN:
+        {
+            if (Event.button.button != SDL_BUTTON_LEFT)
+                break;
+
+            Entity picked = Pick(Event.button.x, Event.button.y);
+            if (picked.id() >= 0 && ecs.hasComponent<Renderable>(picked))
+            {
+                LOG_INFO("Picked entity {}", picked.id());
+                ecs.getComponent<Renderable>(picked).color = PICK_COLOR;
+            }
             break;
+        }
+        case SDL_KEYDOWN:
         case SDL_KEYUP:
-            Keys[Event.key.keysym.sym] = false;
+        {
+            // A replay owns the keys; live ones would make it diverge
+            if (inputReplay.IsOpen())
+                break;
+
+            InputEvent input{stepIndex, Event.key.timestamp,
+                             Event.type == SDL_KEYDOWN ? InputEventType::KeyDown : InputEventType::KeyUp,
+                             static_cast<std::int32_t>(Event.key.keysym.sym)};
+            applyInput(input);
+            if (!Event.key.repeat)
+                inputRecorder.Record(input);
             break;
+        }
         default:
             break;
         }
     }
 }
 
+void Game::applyInput(const InputEvent & event)
+{
+    // Keycodes past the table, such as the arrow keys, are not tracked
+    if (event.key < 0 || event.key >= MAX_KEYS_LENGTH)
+        return;
+
+    Keys[event.key] = event.type == InputEventType::KeyDown;
+}
+
 void Game::pollKeys()
 {
+    PROFILE_SCOPE("Game::pollKeys");
     if (Keys[SDLK_ESCAPE])
         Running = false;
-    
+
+    ComponentType renderableType = ecs.getComponentType<Renderable>();
     for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
         Entity entity(entityId);
         
         // Check if the entity has a Renderable component
-        if (ecs.getEntityManager()->getSignature(entity).test(ecs.getComponentType<Renderable>())) {
-            auto& renderable = ecs.getComponent<Renderable>(entity);
+        if (ecs.getEntityManager()->getSignature(entity).test(renderableType)) {
+            glm::vec3 direction(0.0f);
             if(Keys[SDLK_w])
             {
-                renderable.model = glm::translate(renderable.model, glm::vec3(0.0f, 1.0f, 0.0f) * DeltaTime);
+                direction += glm::vec3(0.0f, 1.0f, 0.0f);
             }
             if(Keys[SDLK_s])
             {
-                renderable.model = glm::translate(renderable.model, glm::vec3(0.0f, -1.0f, 0.0f) * DeltaTime);
+                direction += glm::vec3(0.0f, -1.0f, 0.0f);
             }
             if(Keys[SDLK_a])
             {
-                renderable.model = glm::translate(renderable.model, glm::vec3(-1.0f, 0.0f, 0.0f) * DeltaTime);
+                direction += glm::vec3(-1.0f, 0.0f, 0.0f);
             }
             if(Keys[SDLK_d])
             {
-                renderable.model = glm::translate(renderable.model, glm::vec3(1.0f, 0.0f, 0.0f) * DeltaTime);
+                direction += glm::vec3(1.0f, 0.0f, 0.0f);
+            }
+            if (direction != glm::vec3(0.0f))
+            {
+                hierarchy->SetLocal(entity, glm::translate(hierarchy->GetLocal(entity), direction * DeltaTime));
             }
         }
     }
@@ -207,71 +416,516 @@ void Game::pollKeys()
 
 void Game::update()
 {
-    pollEvents();
+    PROFILE_SCOPE("Game::update");
+    frameStats.BeginSystems();
+    if (inputReplay.IsOpen())
+        inputReplay.Play(stepIndex, [this](const InputEvent & event) { applyInput(event); });
     pollKeys();
+    frameStats.Lap(LAP_INPUT);
+
+    if (!boids->mEntities.empty())
+    {
+        grid->Update();
+        frameStats.Lap(LAP_GRID);
+        boids->Update(DeltaTime);
+        frameStats.Lap(LAP_BOIDS);
+    }
+
+    hierarchy->Propagate();
+    frameStats.Lap(LAP_HIERARCHY);
+
+    if (++stepIndex == inputReplay.Steps() && inputReplay.IsOpen())
+    {
+        LOG_INFO("Replay finished after {} steps", stepIndex);
+        Running = false;
+    }
 }
 
 void Game::render()
 {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    PROFILE_SCOPE("Game::render");
+    frameStats.BeginSystems();
+    // Only the last frame's commands are of interest
+    if (config.recordingDevice)
+        nullDevice.Reset();
+
+    GLState::ResetFrameCounters();
+    renderer.BeginFrame();
+
+    RenderDevice::Current().Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Set up view and projection matrices
-    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+    // Camera matrices are cached and only re-uploaded when they change
+    Camera & cam = ecs.getComponent<Camera>(camera);
+    renderer.SetCamera(cam);
+
+    // Exactly one culler owns visibility: the renderer's compute pass when it
+    // runs, otherwise CullingSystem, whose invisible entities are never
+    // submitted
+    bool cpuCulling = !renderer.GpuCulling();
+    if (cpuCulling)
+        culling->Update(cam.frustum);
+    frameStats.Lap(LAP_CULLING);
 
     // Iterate through all entities
+    ComponentType renderableType = ecs.getComponentType<Renderable>();
+    ComponentType boundsType = ecs.getComponentType<Bounds>();
     for (int entityId = 0; entityId < MAX_ENTITIES; ++entityId) {
         Entity entity(entityId);
+        Signature signature = ecs.getEntityManager()->getSignature(entity);
         
         // Check if the entity has a Renderable component
-        if (ecs.getEntityManager()->getSignature(entity).test(ecs.getComponentType<Renderable>())) {
+        if (signature.test(renderableType)) {
+            if (cpuCulling && signature.test(boundsType) && !culling->IsVisible(entity))
+                continue;
+
             auto& renderable = ecs.getComponent<Renderable>(entity);
+            auto& transform = ecs.getComponent<Transform>(entity);
+
+            renderer.Submit(renderable.mesh, renderable.shader, transform.Interpolated(Alpha), renderable.color);
+        }
+    }
+
+    frameStats.Lap(LAP_SUBMIT);
+
+    // Entities sharing a VAO and program are drawn with one instanced call
+    renderer.Flush();
+    cullMismatches += renderer.Stats().cullMismatches;
+    frameStats.Lap(LAP_FLUSH);
 
-            glUseProgram(renderable.shaderProgram);
+    if (window)
+        SDL_GL_SwapWindow(window);
+    frameStats.Lap(LAP_PRESENT);
+}
 
-            // Set uniforms
-            GLuint modelLoc = glGetUniformLocation(renderable.shaderProgram, "model");
-            GLuint viewLoc = glGetUniformLocation(renderable.shaderProgram, "view");
-            GLuint projectionLoc = glGetUniformLocation(renderable.shaderProgram, "projection");
-            GLuint colorLoc = glGetUniformLocation(renderable.shaderProgram, "color");
 
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(renderable.model));
-            glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-            glUniform4fv(colorLoc, 1, glm::value_ptr(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)));
+void Game::Run(const GameConfig & game_config)
+{
+    config = game_config;
 
-            // Draw the square
-            glBindVertexArray(renderable.VAO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    if (!config.replayPath.empty())
+    {
+        if (!inputReplay.Open(config.replayPath))
+        {
+            LOG_ERROR("Could not read input recording {}", config.replayPath);
+            return;
         }
+        if (inputReplay.TickRate() != config.tickRate)
+            LOG_INFO("Replaying at the recorded tick rate {}", inputReplay.TickRate());
+        config.tickRate = inputReplay.TickRate();
     }
 
-    SDL_GL_SwapWindow(window);
+    if (!init())
+        return;
+
+    if (!config.recordPath.empty() && !inputRecorder.Open(config.recordPath, config.tickRate))
+        LOG_ERROR("Could not record input to {}", config.recordPath);
+
+#ifdef SIGUSR1
+    if (!config.statsPath.empty() || !config.tracePath.empty())
+        std::signal(SIGUSR1, onDumpRequest);
+#endif
+
+    // Hitches are frames over twice their budget: the paced frame period,
+    // or one step when frames are not paced
+    bool paced = config.frameRate > 0.0f && !config.headless && config.benchScene.empty();
+    float budgetRate = paced ? config.frameRate : config.tickRate;
+    frameStats.Init();
+    frameStats.SetHitchThreshold(FRAME_STATS_HITCH_FACTOR * 1000.0 / budgetRate);
+
+    const char * lapNames[LAP_COUNT] = {"scene", "input", "hierarchy", "grid", "boids",
+                                        "culling", "submit", "flush", "present"};
+    for (const char * name : lapNames)
+        frameStats.AddSystem(name);
+
+    if (!config.benchScene.empty())
+        runBench();
+    else if (config.headless)
+        runHeadless();
+    else
+        runWindowed();
+
+    if (inputRecorder.IsOpen())
+    {
+        if (inputRecorder.Close(stepIndex))
+            LOG_INFO("Input of {} steps recorded to {}", stepIndex, config.recordPath);
+        else
+            LOG_ERROR("Could not write input recording {}", config.recordPath);
+    }
+
+    reportStats();
 }
 
+void Game::runWindowed()
+{
+    const double step = 1.0 / config.tickRate;
+    DeltaTime = static_cast<float>(step);
+    double accumulator = 0.0;
 
-void Game::Run()
+    pacer.SetTargetRate(config.frameRate);
+    pacer.Reset();
+
+    // Split of the frame the next BeginFrame closes
+    double updateMs = 0.0;
+    double renderMs = 0.0;
+    int steps = 0;
+
+    std::uint64_t ticks = 0;
+    while (Running)
+    {
+        double frameDelta = pacer.BeginFrame();
+        PROFILE_FRAME();
+        LOG_TRACE("Frame {} s", frameDelta);
+        if (ticks > 0)
+            frameStats.RecordFrame(frameDelta * 1000.0, updateMs, renderMs, steps, renderCounts(renderer.Stats(), culling->Stats()));
+
+        if (dumpRequested)
+        {
+            dumpRequested = 0;
+            writeReports();
+        }
+
+        pollEvents();
+
+        std::uint64_t updateStart = CycleClock::Now();
+        accumulator += frameDelta;
+        steps = 0;
+        while (accumulator >= step && steps < config.maxStepsPerFrame && Running)
+        {
+            update();
+            accumulator -= step;
+            ++steps;
+        }
+
+        // Too far behind to catch up: drop whole steps rather than spiral
+        if (accumulator >= step)
+            accumulator = std::fmod(accumulator, step);
+
+        Alpha = static_cast<float>(accumulator / step);
+        std::uint64_t renderStart = CycleClock::Now();
+        render();
+        std::uint64_t renderEnd = CycleClock::Now();
+
+        updateMs = ticksToMs(renderStart - updateStart);
+        renderMs = ticksToMs(renderEnd - renderStart);
+
+        pacer.Wait();
+
+        if (++ticks == config.maxTicks)
+            Running = false;
+    }
+
+    FramePacerStats pacing = pacer.Stats();
+    LOG_INFO("Frame pacing: {} frames, target {} ms, mean {} ms, jitter {} ms, max deviation {} ms, {} late",
+             pacing.frames, pacing.targetMs, pacing.meanMs, pacing.jitterMs, pacing.maxDeviationMs,
+             pacing.lateFrames);
+}
+
+void Game::runHeadless()
 {
-    if (!init())
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    DeltaTime = 1.0f / config.tickRate;
+
+    std::uint64_t ticks = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (Running && !interrupted)
+    {
+        PROFILE_FRAME();
+        std::uint64_t updateStart = CycleClock::Now();
+        update();
+        double updateMs = ticksToMs(CycleClock::Now() - updateStart);
+        frameStats.RecordFrame(updateMs, updateMs, 0.0, 1);
+
+        if (dumpRequested)
+        {
+            dumpRequested = 0;
+            writeReports();
+        }
+
+        if (++ticks == config.maxTicks)
+            Running = false;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LOG_INFO("Headless: {} ticks in {} s, {} ticks/s", ticks, seconds, seconds > 0.0 ? ticks / seconds : 0.0);
+}
+
+Entity Game::spawnBenchSquare(const glm::vec3 & position)
+{
+    Entity entity = ecs.createEntity();
+    createSquare(entity);
+    hierarchy->SetLocal(entity, glm::translate(glm::mat4(1.0f), position));
+    return entity;
+}
+
+bool Game::setupBench()
+{
+    const std::string & scene = config.benchScene;
+    std::size_t count = config.benchEntities ? config.benchEntities : (MAX_ENTITIES - 1) / 2;
+    if (count > MAX_ENTITIES - 1)
+    {
+        LOG_WARN("{} entities do not fit in NOMAD_MAX_ENTITIES {}; using {}", count, MAX_ENTITIES, MAX_ENTITIES - 1);
+        count = MAX_ENTITIES - 1;
+    }
+
+    benchEntities.clear();
+    benchOrigins.clear();
+    benchRng.seed(BENCH_SEED);
+    benchFrame = 0;
+
+    Camera & cam = ecs.getComponent<Camera>(camera);
+    const float spacing = 1.5f;
+    float halfExtent = std::ceil(std::sqrt(static_cast<float>(count))) * spacing * 0.5f;
+
+    if (scene == "squares" || scene == "churn")
+    {
+        std::uniform_real_distribution<float> coordinate(-halfExtent, halfExtent);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            glm::vec3 origin = scene == "squares" ? gridPosition(i, count, spacing)
+                                                  : glm::vec3(coordinate(benchRng), coordinate(benchRng), 0.0f);
+            benchEntities.push_back(spawnBenchSquare(origin));
+            benchOrigins.push_back(origin);
+        }
+    }
+    else if (scene == "boids")
+    {
+        // About one boid per neighbourhood radius squared
+        BoidSettings settings;
+        settings.worldHalfSize = std::max(10.0f, std::sqrt(static_cast<float>(count)) * settings.radius * 0.5f);
+        halfExtent = settings.worldHalfSize;
+        boids->Init(&ecs, grid, hierarchy, settings);
+
+        std::uniform_real_distribution<float> coordinate(-halfExtent, halfExtent);
+        std::uniform_real_distribution<float> speed(-settings.maxSpeed, settings.maxSpeed);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Entity entity = spawnBenchSquare(glm::vec3(coordinate(benchRng), coordinate(benchRng), 0.0f));
+            ecs.addComponent(entity, Boid{glm::vec3(speed(benchRng), speed(benchRng), 0.0f)});
+            benchEntities.push_back(entity);
+        }
+
+        // The grid indexes world positions, which the first step reads
+        // before it propagates
+        hierarchy->Propagate();
+    }
+    else if (scene == "hierarchy")
+    {
+        // Chains of BENCH_HIERARCHY_DEPTH nodes, each a small step and turn
+        // from its parent; only the roots are driven
+        std::size_t chains = std::max<std::size_t>(1, count / BENCH_HIERARCHY_DEPTH);
+        halfExtent = std::ceil(std::sqrt(static_cast<float>(chains))) * spacing * 2.0f;
+        glm::mat4 link = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)), 0.05f,
+                                     glm::vec3(0.0f, 0.0f, 1.0f));
+
+        std::size_t spawned = 0;
+        for (std::size_t c = 0; c < chains && spawned < count; ++c)
+        {
+            glm::vec3 origin = gridPosition(c, chains, spacing * 4.0f);
+            Entity parent = spawnBenchSquare(origin);
+            benchEntities.push_back(parent);
+            benchOrigins.push_back(origin);
+            ++spawned;
+
+            for (int depth = 1; depth < BENCH_HIERARCHY_DEPTH && spawned < count; ++depth)
+            {
+                Entity child = ecs.createEntity();
+                createSquare(child);
+                hierarchy->Attach(child, parent);
+                hierarchy->SetLocal(child, link);
+                parent = child;
+                ++spawned;
+            }
+        }
+    }
+    else
+    {
+        LOG_ERROR("Unknown bench scene {}; expected squares, boids, churn or hierarchy", scene);
+        return false;
+    }
+
+    frame(cam, halfExtent);
+    LOG_INFO("Bench {}: {} entities", scene, count);
+    return true;
+}
+
+void Game::stepBench()
+{
+    PROFILE_SCOPE("Game::stepBench");
+    const std::string & scene = config.benchScene;
+    float time = benchFrame * DeltaTime;
+
+    if (scene == "squares")
+    {
+        // Every square circles its origin, each at its own phase
+        for (std::size_t i = 0; i < benchEntities.size(); ++i)
+        {
+            float phase = time * 2.0f + i * 0.1f;
+            glm::vec3 offset(std::cos(phase) * 0.25f, std::sin(phase) * 0.25f, 0.0f);
+            hierarchy->SetLocal(benchEntities[i], glm::translate(glm::mat4(1.0f), benchOrigins[i] + offset));
+        }
+    }
+    else if (scene == "churn")
+    {
+        // Replace a fixed share of the squares with new ones elsewhere
+        std::size_t replaced = std::max<std::size_t>(1, static_cast<std::size_t>(benchEntities.size() * BENCH_CHURN_RATE));
+        for (std::size_t n = 0; n < replaced && !benchEntities.empty(); ++n)
+        {
+            std::size_t victim = std::uniform_int_distribution<std::size_t>(0, benchEntities.size() - 1)(benchRng);
+            hierarchy->DestroySubtree(benchEntities[victim]);
+
+            // A quarter turn about the centre keeps the scene the same size
+            glm::vec3 origin(-benchOrigins[victim].y, benchOrigins[victim].x, 0.0f);
+            benchEntities[victim] = spawnBenchSquare(origin);
+            benchOrigins[victim] = origin;
+        }
+    }
+    else if (scene == "hierarchy")
+    {
+        // Turning a root moves its whole chain
+        for (std::size_t i = 0; i < benchEntities.size(); ++i)
+        {
+            glm::mat4 local = glm::translate(glm::mat4(1.0f), benchOrigins[i]);
+            hierarchy->SetLocal(benchEntities[i], glm::rotate(local, time + i * 0.1f, glm::vec3(0.0f, 0.0f, 1.0f)));
+        }
+    }
+
+    ++benchFrame;
+}
+
+void Game::runBench()
+{
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    DeltaTime = 1.0f / config.tickRate;
+    if (!setupBench())
         return;
 
-    unsigned int NOW = SDL_GetPerformanceCounter(), LAST = SDL_GetPerformanceCounter();
-    float frameTime = (1.0f / MAX_FRAMERATE) * 1000.0f;
-    while (Running)
+    bool rendering = !config.headless;
+    std::uint64_t frames = config.maxTicks ? config.maxTicks : DEFAULT_BENCH_FRAMES;
+
+    std::uint64_t measured = 0;
+    std::uint64_t start = 0;
+    for (std::uint64_t i = 0; i < BENCH_WARMUP_FRAMES + frames && Running && !interrupted; ++i)
     {
-        NOW = SDL_GetPerformanceCounter();
-        DeltaTime = calculateDeltaTime(NOW, LAST);
-        std::cout << DeltaTime << std::endl;
+        // Measure from a clean slate once caches and pools have settled
+        if (i == BENCH_WARMUP_FRAMES)
+        {
+            frameStats.Reset();
+            start = CycleClock::Now();
+        }
+
+        PROFILE_FRAME();
+        pollEvents();
+
+        std::uint64_t frameStart = CycleClock::Now();
+        frameStats.BeginSystems();
+        stepBench();
+        frameStats.Lap(LAP_SCENE);
         update();
-        render();
-        float timeToWait = frameTime - (DeltaTime * 1000.0f);
-        if (timeToWait > 0)
-            SDL_Delay(timeToWait);
+
+        std::uint64_t renderStart = CycleClock::Now();
+        if (rendering)
+        {
+            Alpha = 1.0f;
+            render();
+        }
+        std::uint64_t frameEnd = CycleClock::Now();
+
+        frameStats.RecordFrame(ticksToMs(frameEnd - frameStart), ticksToMs(renderStart - frameStart),
+                               ticksToMs(frameEnd - renderStart), 1,
+                               rendering ? renderCounts(renderer.Stats(), culling->Stats()) : FrameRenderCounts{});
+        if (i >= BENCH_WARMUP_FRAMES)
+            ++measured;
+    }
+
+    double seconds = measured ? ticksToMs(CycleClock::Now() - start) * 1e-3 : 0.0;
+    LOG_INFO("Bench {} ({}): {} frames in {} s, {} frames/s", config.benchScene,
+             config.headless ? "headless" : config.recordingDevice ? "recording device" : "GL", measured, seconds,
+             seconds > 0.0 ? measured / seconds : 0.0);
+}
+
+void Game::reportStats()
+{
+    FrameStatsWindow session = frameStats.Session();
+    LOG_INFO("Frame time: {} frames, p50 {} ms, p95 {} ms, p99 {} ms, max {} ms, {} hitches",
+             session.frames, session.frame.p50Ms, session.frame.p95Ms, session.frame.p99Ms, session.frame.maxMs,
+             session.hitches);
+    LOG_INFO("Update: p50 {} ms, p99 {} ms, max {} ms; render: p50 {} ms, p99 {} ms, max {} ms",
+             session.update.p50Ms, session.update.p99Ms, session.update.maxMs,
+             session.render.p50Ms, session.render.p99Ms, session.render.maxMs);
+    for (std::size_t i = 0; i < frameStats.SystemCount(); ++i)
+    {
+        FrameTimeSummary system = frameStats.SystemSession(i);
+        if (system.maxMs > 0.0)
+            LOG_INFO("  {}: mean {} ms, p50 {} ms, p99 {} ms, max {} ms", frameStats.SystemName(i), system.meanMs,
+                     system.p50Ms, system.p99Ms, system.maxMs);
+    }
+    if (session.frames > 0 && session.renderTotal.drawCalls > 0)
+    {
+        double frames = static_cast<double>(session.frames);
+        LOG_INFO("Per frame: {} draws, {} instances, {} triangles, {} program / {} VAO / {} texture / {} buffer binds, "
+                 "{} redundant calls elided, {} uniform uploads, {} bytes uploaded",
+                 session.renderTotal.drawCalls / frames, session.renderTotal.instances / frames,
+                 session.renderTotal.triangles / frames, session.renderTotal.programBinds / frames,
+                 session.renderTotal.vaoBinds / frames, session.renderTotal.textureBinds / frames,
+                 session.renderTotal.bufferBinds / frames, session.renderTotal.elidedCalls / frames,
+                 session.renderTotal.uniformUploads / frames, session.renderTotal.bytesUploaded / frames);
+    }
+    if (session.frames > 0 && session.renderTotal.cullVisible + session.renderTotal.cullCulled > 0)
+    {
+        double frames = static_cast<double>(session.frames);
+        LOG_INFO("Culling per frame: {} visible, {} culled, gather {} us, test {} us",
+                 session.renderTotal.cullVisible / frames, session.renderTotal.cullCulled / frames,
+                 session.renderTotal.cullGatherUs / frames, session.renderTotal.cullTestUs / frames);
+    }
+
+    if (config.cullCrossCheck && renderer.GpuCulling())
+    {
+        if (cullMismatches > 0)
+            LOG_ERROR("GPU culling disagreed with the CPU reference in {} commands", cullMismatches);
+        else
+            LOG_INFO("GPU culling matched the CPU reference in all {} frames", session.frames);
+    }
+
+    writeReports();
+}
+
+void Game::writeReports()
+{
+    if (!config.statsPath.empty())
+    {
+        if (frameStats.Dump(config.statsPath))
+            LOG_INFO("Frame stats written to {}", config.statsPath);
+        else
+            LOG_ERROR("Could not write frame stats to {}", config.statsPath);
+    }
+
+    if (!config.tracePath.empty())
+    {
+        if (!NOMAD_PROFILE)
+            LOG_WARN("Built without NOMAD_PROFILE; the trace has no zones");
+
+        if (Profiler::WriteChromeTrace(config.tracePath, config.traceFrames))
+            LOG_INFO("Trace of the last {} frames written to {}", config.traceFrames, config.tracePath);
+        else
+            LOG_ERROR("Could not write trace to {}", config.tracePath);
     }
 }
 
 void Game::Close()
 {
+    renderer.Shutdown();
+    ResourceLoader::ReleaseAll();
+
+    if (config.headless || config.recordingDevice)
+    {
+        RenderDevice::SetCurrent(nullptr);
+        return;
+    }
+
     if (ctx)
         SDL_GL_DeleteContext(ctx);
 
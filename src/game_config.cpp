@@ -0,0 +1,128 @@
+#include <game_config.h>
+#include <log.h>
+
+#include <cstdlib>
+#include <cstring>
+
+GameConfig GameConfig::FromArgs(int argc, char * argv[])
+{
+    GameConfig config;
+
+    const char * headless = std::getenv("NOMAD_HEADLESS");
+    if (headless && std::strcmp(headless, "0") != 0)
+        config.headless = true;
+
+    const char * stats = std::getenv("NOMAD_STATS");
+    if (stats)
+        config.statsPath = stats;
+
+    const char * trace = std::getenv("NOMAD_TRACE");
+    if (trace)
+        config.tracePath = trace;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char * arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--headless") == 0)
+        {
+            config.headless = true;
+        }
+        else if (std::strcmp(arg, "--recording-device") == 0)
+        {
+            config.recordingDevice = true;
+        }
+        else if (std::strcmp(arg, "--gpu-culling") == 0)
+        {
+            config.gpuCulling = true;
+        }
+        else if (std::strcmp(arg, "--cull-cross-check") == 0)
+        {
+            config.gpuCulling = true;
+            config.cullCrossCheck = true;
+        }
+        else if (std::strcmp(arg, "--tick-rate") == 0 && hasValue)
+        {
+            float rate = std::strtof(argv[++i], nullptr);
+            if (rate > 0.0f)
+                config.tickRate = rate;
+            else
+                LOG_WARN("Ignoring tick rate {}", argv[i]);
+        }
+        else if (std::strcmp(arg, "--frame-rate") == 0 && hasValue)
+        {
+            float rate = std::strtof(argv[++i], nullptr);
+            if (rate >= 0.0f)
+                config.frameRate = rate;
+            else
+                LOG_WARN("Ignoring frame rate {}", argv[i]);
+        }
+        else if (std::strcmp(arg, "--vsync") == 0 && hasValue)
+        {
+            const char * mode = argv[++i];
+            if (std::strcmp(mode, "off") == 0)
+                config.swapInterval = 0;
+            else if (std::strcmp(mode, "on") == 0)
+                config.swapInterval = 1;
+            else if (std::strcmp(mode, "adaptive") == 0)
+                config.swapInterval = -1;
+            else
+                LOG_WARN("Ignoring vsync mode {}", mode);
+        }
+        else if (std::strcmp(arg, "--max-steps") == 0 && hasValue)
+        {
+            int steps = std::atoi(argv[++i]);
+            if (steps > 0)
+                config.maxStepsPerFrame = steps;
+            else
+                LOG_WARN("Ignoring max steps {}", argv[i]);
+        }
+        else if ((std::strcmp(arg, "--ticks") == 0 || std::strcmp(arg, "--frames") == 0) && hasValue)
+        {
+            config.maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(arg, "--stats") == 0 && hasValue)
+        {
+            config.statsPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--trace") == 0 && hasValue)
+        {
+            config.tracePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--trace-frames") == 0 && hasValue)
+        {
+            long long frames = std::atoll(argv[++i]);
+            if (frames > 0 && frames <= PROFILER_MAX_FRAMES)
+                config.traceFrames = static_cast<std::size_t>(frames);
+            else
+                LOG_WARN("Ignoring trace frames {}", argv[i]);
+        }
+        else if (std::strcmp(arg, "--bench") == 0 && hasValue)
+        {
+            config.benchScene = argv[++i];
+        }
+        else if (std::strcmp(arg, "--bench-entities") == 0 && hasValue)
+        {
+            long long entities = std::atoll(argv[++i]);
+            if (entities > 0)
+                config.benchEntities = static_cast<std::size_t>(entities);
+            else
+                LOG_WARN("Ignoring bench entities {}", argv[i]);
+        }
+        else if (std::strcmp(arg, "--record") == 0 && hasValue)
+        {
+            config.recordPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--replay") == 0 && hasValue)
+        {
+            config.replayPath = argv[++i];
+        }
+        else
+        {
+            LOG_WARN("Unknown argument: {}", arg);
+        }
+    }
+
+    return config;
+}
@@ -0,0 +1,298 @@
+#include <gl_state.h>
+#include <render_device.h>
+
+#include <array>
+
+namespace GLState
+{
+    namespace
+    {
+        // Shadow value meaning "not known", so the next call always goes through
+        constexpr GLuint UNKNOWN = 0xFFFFFFFF;
+
+        constexpr int BUFFER_TARGETS = 8;
+        constexpr int INDEXED_BINDINGS = 16;
+        constexpr int TEXTURE_UNITS = 32;
+        constexpr int CAPABILITIES = 6;
+
+        const GLenum buffer_targets[BUFFER_TARGETS] = {
+            GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER,
+            GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER};
+
+        const GLenum capabilities[CAPABILITIES] = {
+            GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_PROGRAM_POINT_SIZE};
+
+        struct IndexedBinding
+        {
+            GLuint buffer;
+            GLintptr offset;
+            GLsizeiptr size;
+        };
+
+        struct State
+        {
+            GLuint program;
+            GLuint vao;
+            std::array<GLuint, BUFFER_TARGETS> buffers;
+            std::array<IndexedBinding, INDEXED_BINDINGS> uniformBindings;
+            std::array<IndexedBinding, INDEXED_BINDINGS> storageBindings;
+            GLenum activeUnit;
+            std::array<GLuint, TEXTURE_UNITS> textures2D;
+            std::array<GLuint, CAPABILITIES> enabled;
+        };
+
+        State state;
+        Counters counters;
+        bool initialized = false;
+
+        void reset()
+        {
+            state.program = UNKNOWN;
+            state.vao = UNKNOWN;
+            state.buffers.fill(UNKNOWN);
+            state.uniformBindings.fill(IndexedBinding{UNKNOWN, 0, 0});
+            state.storageBindings.fill(IndexedBinding{UNKNOWN, 0, 0});
+            state.activeUnit = UNKNOWN;
+            state.textures2D.fill(UNKNOWN);
+            state.enabled.fill(UNKNOWN);
+            initialized = true;
+        }
+
+        State & current()
+        {
+            if (!initialized)
+                reset();
+            return state;
+        }
+
+        int bufferSlot(GLenum target)
+        {
+            for (int i = 0; i < BUFFER_TARGETS; ++i)
+                if (buffer_targets[i] == target)
+                    return i;
+            return -1;
+        }
+
+        int capabilitySlot(GLenum capability)
+        {
+            for (int i = 0; i < CAPABILITIES; ++i)
+                if (capabilities[i] == capability)
+                    return i;
+            return -1;
+        }
+
+        IndexedBinding * indexedBinding(GLenum target, GLuint index)
+        {
+            if (index >= INDEXED_BINDINGS)
+                return nullptr;
+            if (target == GL_UNIFORM_BUFFER)
+                return &current().uniformBindings[index];
+            if (target == GL_SHADER_STORAGE_BUFFER)
+                return &current().storageBindings[index];
+            return nullptr;
+        }
+
+        // True if the call has to be issued; updates the shadow value
+        template <typename T>
+        bool update(T & shadow, T value)
+        {
+            if (shadow == value)
+            {
+                ++counters.elided;
+                return false;
+            }
+            shadow = value;
+            ++counters.issued;
+            return true;
+        }
+
+        void setCapability(GLenum capability, GLuint value)
+        {
+            int slot = capabilitySlot(capability);
+            if (slot >= 0 && !update(current().enabled[slot], value))
+                return;
+            if (slot < 0)
+                ++counters.issued;
+
+            RenderDevice::Current().SetCapability(capability, value != 0);
+        }
+
+        void forgetBuffer(GLuint buffer)
+        {
+            State & s = current();
+            for (auto & bound : s.buffers)
+                if (bound == buffer)
+                    bound = 0;
+            for (auto & binding : s.uniformBindings)
+                if (binding.buffer == buffer)
+                    binding = IndexedBinding{0, 0, 0};
+            for (auto & binding : s.storageBindings)
+                if (binding.buffer == buffer)
+                    binding = IndexedBinding{0, 0, 0};
+        }
+    } // namespace
+
+    void UseProgram(GLuint program)
+    {
+        if (!update(current().program, program))
+            return;
+
+        ++counters.programBinds;
+        RenderDevice::Current().UseProgram(program);
+    }
+
+    void BindVertexArray(GLuint vao)
+    {
+        if (!update(current().vao, vao))
+            return;
+
+        ++counters.vaoBinds;
+        RenderDevice::Current().BindVertexArray(vao);
+
+        // The element array binding is part of the VAO
+        current().buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer)
+    {
+        int slot = bufferSlot(target);
+        if (slot >= 0 && !update(current().buffers[slot], buffer))
+            return;
+        if (slot < 0)
+            ++counters.issued;
+
+        ++counters.bufferBinds;
+        RenderDevice::Current().BindBuffer(target, buffer);
+    }
+
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        // A whole-buffer binding is recorded with size 0
+        IndexedBinding * binding = indexedBinding(target, index);
+        if (binding && binding->buffer == buffer && binding->size == 0)
+        {
+            ++counters.elided;
+            return;
+        }
+        ++counters.issued;
+        ++counters.bufferBinds;
+
+        RenderDevice::Current().BindBufferBase(target, index, buffer);
+
+        if (binding)
+            *binding = IndexedBinding{buffer, 0, 0};
+
+        // Indexed binds also replace the generic binding for the target
+        int slot = bufferSlot(target);
+        if (slot >= 0)
+            current().buffers[slot] = buffer;
+    }
+
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        IndexedBinding * binding = indexedBinding(target, index);
+        if (binding && binding->buffer == buffer && binding->offset == offset && binding->size == size)
+        {
+            ++counters.elided;
+            return;
+        }
+        ++counters.issued;
+        ++counters.bufferBinds;
+
+        RenderDevice::Current().BindBufferRange(target, index, buffer, offset, size);
+
+        if (binding)
+            *binding = IndexedBinding{buffer, offset, size};
+
+        int slot = bufferSlot(target);
+        if (slot >= 0)
+            current().buffers[slot] = buffer;
+    }
+
+    void ActiveTexture(GLenum unit)
+    {
+        if (update(current().activeUnit, unit))
+            RenderDevice::Current().ActiveTexture(unit);
+    }
+
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        State & s = current();
+        GLuint unit = s.activeUnit == UNKNOWN ? UNKNOWN : s.activeUnit - GL_TEXTURE0;
+
+        // Only 2D textures on known units are shadowed
+        if (target == GL_TEXTURE_2D && unit < TEXTURE_UNITS)
+        {
+            if (!update(s.textures2D[unit], texture))
+                return;
+        }
+        else
+        {
+            ++counters.issued;
+        }
+
+        ++counters.textureBinds;
+        RenderDevice::Current().BindTexture(target, texture);
+    }
+
+    void Enable(GLenum capability)
+    {
+        setCapability(capability, 1);
+    }
+
+    void Disable(GLenum capability)
+    {
+        setCapability(capability, 0);
+    }
+
+    void DeleteProgram(GLuint program)
+    {
+        if (current().program == program)
+            current().program = UNKNOWN;
+        RenderDevice::Current().DeleteProgram(program);
+    }
+
+    void DeleteVertexArrays(GLsizei count, const GLuint * vaos)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+            if (current().vao == vaos[i])
+                current().vao = 0;
+        for (GLsizei i = 0; i < count; ++i)
+            RenderDevice::Current().DeleteVertexArray(vaos[i]);
+    }
+
+    void DeleteBuffers(GLsizei count, const GLuint * buffers)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            forgetBuffer(buffers[i]);
+            RenderDevice::Current().DeleteBuffer(buffers[i]);
+        }
+    }
+
+    void DeleteTextures(GLsizei count, const GLuint * textures)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            for (auto & bound : current().textures2D)
+                if (bound == textures[i])
+                    bound = 0;
+            RenderDevice::Current().DeleteTexture(textures[i]);
+        }
+    }
+
+    void Invalidate()
+    {
+        reset();
+    }
+
+    const Counters & FrameCounters()
+    {
+        return counters;
+    }
+
+    void ResetFrameCounters()
+    {
+        counters = Counters{};
+    }
+} // namespace GLState
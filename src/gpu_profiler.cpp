@@ -0,0 +1,121 @@
+#include <gpu_profiler.h>
+#include <render_device.h>
+
+void GpuProfiler::Init()
+{
+    if (!NOMAD_PROFILE)
+        return;
+
+    // Two queries per zone, GPU_PROFILER_ZONES zones per frame
+    queries.resize(2 * GPU_PROFILER_ZONES * GPU_PROFILER_FRAMES);
+    RenderDevice::Current().CreateQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+    for (int f = 0; f < GPU_PROFILER_FRAMES; ++f)
+    {
+        for (int z = 0; z < GPU_PROFILER_ZONES; ++z)
+        {
+            std::size_t first = 2 * (f * GPU_PROFILER_ZONES + z);
+            frames[f].zones[z] = Zone{nullptr, queries[first], queries[first + 1]};
+        }
+        frames[f].count = 0;
+    }
+
+    results.reserve(GPU_PROFILER_ZONES);
+    if (!track)
+        track = Profiler::CreateTrack("GPU");
+
+    current = 0;
+    depth = 0;
+    droppedFrames = 0;
+    enabled = true;
+}
+
+void GpuProfiler::Shutdown()
+{
+    if (!enabled)
+        return;
+
+    RenderDevice::Current().DeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    queries.clear();
+    results.clear();
+    enabled = false;
+}
+
+void GpuProfiler::BeginFrame()
+{
+    if (!enabled)
+        return;
+
+    RenderDevice & device = RenderDevice::Current();
+    gpuSync = device.Timestamp();
+    cpuSync = CycleClock::Now();
+
+    current = (current + 1) % GPU_PROFILER_FRAMES;
+    readBack(frames[current]);
+    frames[current].count = 0;
+    depth = 0;
+}
+
+void GpuProfiler::readBack(Frame & frame)
+{
+    if (frame.count == 0)
+        return;
+
+    RenderDevice & device = RenderDevice::Current();
+
+    // Reading an unfinished query would wait for the GPU; give the frame up
+    for (int i = 0; i < frame.count; ++i)
+    {
+        if (!device.QueryAvailable(frame.zones[i].end))
+        {
+            ++droppedFrames;
+            return;
+        }
+    }
+
+    results.clear();
+    double ticksPerNs = 1.0 / CycleClock::NanosecondsPerTick();
+    for (int i = 0; i < frame.count; ++i)
+    {
+        Zone const & zone = frame.zones[i];
+        GLuint64 begin = device.QueryResult(zone.begin);
+        GLuint64 end = device.QueryResult(zone.end);
+        results.push_back(GpuZoneTiming{zone.name, (end - begin) * 1e-6});
+
+        // Place the zone on CycleClock by its distance from the last sync
+        double sinceSync = static_cast<double>(static_cast<GLint64>(begin) - gpuSync);
+        std::uint64_t beginTicks = cpuSync + static_cast<std::int64_t>(sinceSync * ticksPerNs);
+        std::uint64_t endTicks = beginTicks + static_cast<std::uint64_t>((end - begin) * ticksPerNs);
+        Profiler::RecordOn(track, zone.name, beginTicks, endTicks);
+    }
+}
+
+void GpuProfiler::Begin(const char * name)
+{
+    if (!enabled)
+        return;
+
+    Frame & frame = frames[current];
+    if (frame.count == GPU_PROFILER_ZONES)
+    {
+        // Still balanced by End, which sees the -1 and times nothing
+        if (depth < GPU_PROFILER_ZONES)
+            open[depth++] = -1;
+        return;
+    }
+
+    int index = frame.count++;
+    frame.zones[index].name = name;
+    RenderDevice::Current().QueryTimestamp(frame.zones[index].begin);
+    open[depth++] = index;
+}
+
+void GpuProfiler::End()
+{
+    if (!enabled || depth == 0)
+        return;
+
+    int index = open[--depth];
+    if (index >= 0)
+        RenderDevice::Current().QueryTimestamp(frames[current].zones[index].end);
+}
@@ -0,0 +1,277 @@
+#include <hierarchy.h>
+#include <profiler.h>
+
+#include <algorithm>
+
+namespace
+{
+    // entityToSlot value during a rebuild for entities that were nodes before it
+    constexpr int WAS_NODE = -2;
+} // namespace
+
+void HierarchySystem::Init(ECS * ecs)
+{
+    this->ecs = ecs;
+    entityToSlot.fill(-1);
+    orderDirty = true;
+}
+
+bool HierarchySystem::Attach(Entity child, Entity parent)
+{
+    for (Entity ancestor = parent; ancestor.id() >= 0;)
+    {
+        if (ancestor.id() == child.id())
+            return false;
+        if (!ecs->hasComponent<Parent>(ancestor))
+            break;
+        ancestor = ecs->getComponent<Parent>(ancestor).entity;
+    }
+
+    removeFromParent(child);
+
+    if (ecs->hasComponent<Parent>(child))
+        ecs->getComponent<Parent>(child).entity = parent;
+    else
+        ecs->addComponent(child, Parent{parent});
+
+    if (parent.id() >= 0)
+    {
+        if (!ecs->hasComponent<Children>(parent))
+            ecs->addComponent(parent, Children{});
+        ecs->getComponent<Children>(parent).entities.push_back(child);
+    }
+
+    orderDirty = true;
+    return true;
+}
+
+void HierarchySystem::Detach(Entity child)
+{
+    Attach(child, Entity(-1));
+}
+
+void HierarchySystem::SetLocal(Entity entity, const glm::mat4 & local)
+{
+    ecs->getComponent<Transform>(entity).local = local;
+
+    // A pending rebuild reads locals straight from the components
+    if (orderDirty)
+        return;
+
+    int slot = entityToSlot[entity.id()];
+    if (slot < 0)
+        return;
+
+    nodeLocal[slot] = local;
+    if (!nodeDirty[slot])
+    {
+        nodeDirty[slot] = 1;
+        ++dirtyCount;
+    }
+}
+
+const glm::mat4 & HierarchySystem::GetLocal(Entity entity)
+{
+    return ecs->getComponent<Transform>(entity).local;
+}
+
+const glm::mat4 & HierarchySystem::GetWorld(Entity entity)
+{
+    int slot = slotOf(entity);
+    if (slot < 0)
+        return ecs->getComponent<Transform>(entity).world;
+    return nodeWorld[slot];
+}
+
+void HierarchySystem::DestroySubtree(Entity root)
+{
+    PROFILE_SCOPE("HierarchySystem::DestroySubtree");
+    // Gather the whole subtree first so the order is only rebuilt once
+    std::vector<Entity> doomed{root};
+    for (std::size_t i = 0; i < doomed.size(); ++i)
+    {
+        if (!ecs->hasComponent<Children>(doomed[i]))
+            continue;
+
+        // A destroyed child's id stays listed and may have been reused
+        for (auto const & child : ecs->getComponent<Children>(doomed[i]).entities)
+            if (ecs->hasComponent<Parent>(child) && ecs->getComponent<Parent>(child).entity.id() == doomed[i].id())
+                doomed.push_back(child);
+    }
+
+    removeFromParent(root);
+
+    for (auto it = doomed.rbegin(); it != doomed.rend(); ++it)
+        ecs->destroyEntity(*it);
+
+    orderDirty = true;
+}
+
+void HierarchySystem::Propagate()
+{
+    PROFILE_SCOPE("HierarchySystem::Propagate");
+    // Whatever moved last step is interpolated from where it ended up
+    for (int entityId : moved)
+    {
+        Entity entity(entityId);
+        if (!ecs->hasComponent<Transform>(entity))
+            continue;
+        Transform & transform = ecs->getComponent<Transform>(entity);
+        transform.previous = transform.world;
+    }
+    moved.clear();
+
+    if (orderDirty)
+        rebuildOrder();
+
+    updatedCount = 0;
+    if (dirtyCount == 0)
+        return;
+
+    // Parents precede children, so a parent's dirty flag is final by the time
+    // its children are visited
+    std::size_t first = std::find(nodeDirty.begin(), nodeDirty.end(), 1) - nodeDirty.begin();
+    for (std::size_t i = first; i < nodeEntity.size(); ++i)
+    {
+        int parent = nodeParent[i];
+        if (parent >= 0 && nodeDirty[parent])
+            nodeDirty[i] = 1;
+
+        if (!nodeDirty[i])
+            continue;
+
+        nodeWorld[i] = parent >= 0 ? nodeWorld[parent] * nodeLocal[i] : nodeLocal[i];
+        Transform & transform = ecs->getComponent<Transform>(Entity(nodeEntity[i]));
+        transform.world = nodeWorld[i];
+        if (nodeFresh[i])
+        {
+            transform.previous = nodeWorld[i];
+            nodeFresh[i] = 0;
+        }
+        else
+        {
+            moved.push_back(nodeEntity[i]);
+        }
+        ++updatedCount;
+    }
+
+    std::fill(nodeDirty.begin() + first, nodeDirty.end(), 0);
+    dirtyCount = 0;
+}
+
+void HierarchySystem::rebuildOrder()
+{
+    std::vector<int> oldEntities;
+    oldEntities.swap(nodeEntity);
+    for (int entityId : oldEntities)
+        entityToSlot[entityId] = WAS_NODE;
+
+    nodeParent.clear();
+    nodeLocal.clear();
+    nodeWorld.clear();
+    nodeDirty.clear();
+    nodeFresh.clear();
+
+    auto push = [this](Entity entity, int parentSlot) {
+        nodeFresh.push_back(entityToSlot[entity.id()] != WAS_NODE);
+        entityToSlot[entity.id()] = static_cast<int>(nodeEntity.size());
+        nodeEntity.push_back(entity.id());
+        nodeParent.push_back(parentSlot);
+        nodeLocal.push_back(ecs->getComponent<Transform>(entity).local);
+        nodeWorld.push_back(glm::mat4(1.0f));
+        nodeDirty.push_back(1);
+    };
+
+    // Roots first: no parent, or a parent that is not part of the hierarchy
+    for (auto const & entity : mEntities)
+    {
+        if (!ecs->hasComponent<Parent>(entity))
+        {
+            push(entity, -1);
+            continue;
+        }
+
+        Entity parent = ecs->getComponent<Parent>(entity).entity;
+        if (parent.id() < 0 || !ecs->hasComponent<Transform>(parent))
+            push(entity, -1);
+    }
+
+    // nodeEntity doubles as the BFS queue, which leaves it sorted by depth
+    auto expand = [this, &push](std::size_t first) {
+        for (std::size_t slot = first; slot < nodeEntity.size(); ++slot)
+        {
+            Entity entity(nodeEntity[slot]);
+            if (!ecs->hasComponent<Children>(entity))
+                continue;
+
+            for (auto const & child : ecs->getComponent<Children>(entity).entities)
+            {
+                // A destroyed child's id stays listed and may have been reused
+                if (!ecs->hasComponent<Transform>(child) || !ecs->hasComponent<Parent>(child) ||
+                    ecs->getComponent<Parent>(child).entity.id() != entity.id())
+                    continue;
+                if (entityToSlot[child.id()] < 0)
+                    push(child, static_cast<int>(slot));
+            }
+        }
+    };
+    expand(0);
+
+    // A parent destroyed on its own can leave its id to an entity that does
+    // not list the children; they carry on as roots
+    std::size_t reached = nodeEntity.size();
+    for (auto const & entity : mEntities)
+    {
+        if (entityToSlot[entity.id()] >= 0)
+            continue;
+
+        Entity parent = ecs->getComponent<Parent>(entity).entity;
+        bool listed = false;
+        if (ecs->hasComponent<Children>(parent))
+            for (auto const & sibling : ecs->getComponent<Children>(parent).entities)
+                listed = listed || sibling.id() == entity.id();
+        if (!listed)
+            push(entity, -1);
+    }
+    expand(reached);
+
+    // Entities that left the hierarchy
+    for (int entityId : oldEntities)
+        if (entityToSlot[entityId] == WAS_NODE)
+            entityToSlot[entityId] = -1;
+
+    dirtyCount = nodeEntity.size();
+    orderDirty = false;
+}
+
+void HierarchySystem::entityAdded(Entity)
+{
+    orderDirty = true;
+}
+
+void HierarchySystem::entityRemoved(Entity)
+{
+    orderDirty = true;
+}
+
+void HierarchySystem::removeFromParent(Entity child)
+{
+    if (!ecs->hasComponent<Parent>(child))
+        return;
+
+    Entity parent = ecs->getComponent<Parent>(child).entity;
+    if (parent.id() < 0 || !ecs->hasComponent<Children>(parent))
+        return;
+
+    auto & siblings = ecs->getComponent<Children>(parent).entities;
+    siblings.erase(std::remove_if(siblings.begin(), siblings.end(),
+                                  [&](Entity e) { return e.id() == child.id(); }),
+                   siblings.end());
+}
+
+int HierarchySystem::slotOf(Entity entity)
+{
+    if (orderDirty)
+        rebuildOrder();
+    return entityToSlot[entity.id()];
+}
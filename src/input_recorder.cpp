@@ -0,0 +1,155 @@
+#include <input_recorder.h>
+
+#include <cstring>
+
+namespace
+{
+    const char magic[4] = {'N', 'M', 'I', 'R'};
+    constexpr std::uint8_t VERSION = 1;
+    constexpr std::size_t HEADER_SIZE = sizeof(magic) + 1 + 4;
+
+    // LEB128: seven bits per byte, low bits first
+    bool get(const std::vector<unsigned char> & data, std::size_t & at, std::uint64_t & value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && at < data.size(); shift += 7)
+        {
+            unsigned char byte = data[at++];
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+} // namespace
+
+bool InputRecorder::Open(const std::string & path, float tick_rate)
+{
+    Close(lastStep);
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    buffer.clear();
+    lastStep = 0;
+    lastTimestamp = 0;
+    failed = false;
+
+    std::uint32_t rate;
+    std::memcpy(&rate, &tick_rate, sizeof(rate));
+    for (char c : magic)
+        buffer.push_back(static_cast<unsigned char>(c));
+    buffer.push_back(VERSION);
+    for (int i = 0; i < 4; ++i)
+        buffer.push_back(static_cast<unsigned char>(rate >> (8 * i)));
+    return true;
+}
+
+void InputRecorder::put(std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(value));
+}
+
+void InputRecorder::flush()
+{
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        failed = true;
+    buffer.clear();
+}
+
+void InputRecorder::Record(const InputEvent & event)
+{
+    if (!file)
+        return;
+
+    put(event.step - lastStep);
+    buffer.push_back(static_cast<unsigned char>(event.type));
+    // Timestamps wrap after 49 days; the delta wraps with them
+    put(static_cast<std::uint32_t>(event.timestamp - lastTimestamp));
+    put(static_cast<std::uint32_t>(event.key));
+
+    lastStep = event.step;
+    lastTimestamp = event.timestamp;
+
+    if (buffer.size() >= INPUT_RECORDER_FLUSH_BYTES)
+        flush();
+}
+
+bool InputRecorder::Close(std::uint64_t steps)
+{
+    if (!file)
+        return false;
+
+    put(steps >= lastStep ? steps - lastStep : 0);
+    buffer.push_back(static_cast<unsigned char>(InputEventType::End));
+    flush();
+
+    bool written = !failed && !std::ferror(file);
+    written = std::fclose(file) == 0 && written;
+    file = nullptr;
+    return written;
+}
+
+bool InputReplay::Open(const std::string & path)
+{
+    events.clear();
+    cursor = 0;
+    open = false;
+
+    std::FILE * file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> data;
+    unsigned char chunk[4096];
+    std::size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    std::fclose(file);
+
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), magic, sizeof(magic)) != 0 ||
+        data[sizeof(magic)] != VERSION)
+        return false;
+
+    std::uint32_t rate = 0;
+    for (int i = 0; i < 4; ++i)
+        rate |= static_cast<std::uint32_t>(data[sizeof(magic) + 1 + i]) << (8 * i);
+    std::memcpy(&tickRate, &rate, sizeof(tickRate));
+
+    std::size_t at = HEADER_SIZE;
+    std::uint64_t step = 0;
+    std::uint32_t timestamp = 0;
+    while (at < data.size())
+    {
+        std::uint64_t delta;
+        if (!get(data, at, delta) || at >= data.size())
+            return false;
+        step += delta;
+
+        InputEventType type = static_cast<InputEventType>(data[at++]);
+        if (type == InputEventType::End)
+        {
+            steps = step;
+            open = true;
+            return true;
+        }
+        if (type != InputEventType::KeyDown && type != InputEventType::KeyUp)
+            return false;
+
+        std::uint64_t timeDelta, key;
+        if (!get(data, at, timeDelta) || !get(data, at, key))
+            return false;
+        timestamp += static_cast<std::uint32_t>(timeDelta);
+
+        events.push_back(InputEvent{step, timestamp, type, static_cast<std::int32_t>(static_cast<std::uint32_t>(key))});
+    }
+
+    // No end record: the recording was cut short
+    return false;
+}
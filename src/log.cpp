@@ -0,0 +1,243 @@
+#include <log.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Log
+{
+    namespace
+    {
+        const char * const level_names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+        struct Pending
+        {
+            LogRecord record;
+            std::uint32_t thread;
+        };
+
+        struct Logger
+        {
+            std::mutex registryMutex;
+            std::vector<std::unique_ptr<LogRing>> rings;
+            std::vector<std::uint64_t> reportedDrops;
+            std::uint64_t startTicks = 0;
+
+            // Held by whoever drains, so rings only ever have one consumer
+            std::mutex drainMutex;
+            std::vector<Pending> batch;
+            std::string text;
+            std::FILE * output = stdout;
+
+            std::atomic<bool> running{false};
+            std::thread worker;
+
+            ~Logger() { Shutdown(); }
+        };
+
+        Logger logger;
+
+        void appendf(std::string & out, const char * format, ...)
+        {
+            char buffer[64];
+            va_list args;
+            va_start(args, format);
+            int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+            va_end(args);
+            if (length > 0)
+                out.append(buffer, std::min<std::size_t>(length, sizeof(buffer) - 1));
+        }
+
+        // Appends the next argument and returns the payload position after it
+        std::size_t appendArg(std::string & out, const LogRecord & record, std::size_t at)
+        {
+            auto tag = static_cast<LogArg>(record.payload[at++]);
+            const std::uint8_t * value = record.payload + at;
+
+            switch (tag)
+            {
+            case LogArg::Int:
+            {
+                std::int64_t v;
+                std::memcpy(&v, value, sizeof(v));
+                appendf(out, "%lld", static_cast<long long>(v));
+                return at + sizeof(v);
+            }
+            case LogArg::Uint:
+            {
+                std::uint64_t v;
+                std::memcpy(&v, value, sizeof(v));
+                appendf(out, "%llu", static_cast<unsigned long long>(v));
+                return at + sizeof(v);
+            }
+            case LogArg::Float:
+            {
+                double v;
+                std::memcpy(&v, value, sizeof(v));
+                appendf(out, "%g", v);
+                return at + sizeof(v);
+            }
+            case LogArg::Bool:
+                out += *value ? "true" : "false";
+                return at + 1;
+            case LogArg::Char:
+                out += static_cast<char>(*value);
+                return at + 1;
+            case LogArg::String:
+                out.append(reinterpret_cast<const char *>(value + 1), *value);
+                return at + 1 + *value;
+            case LogArg::HeapString:
+            {
+                char * text;
+                std::memcpy(&text, value, sizeof(text));
+                out += text;
+                return at + sizeof(text);
+            }
+            case LogArg::Pointer:
+            {
+                const void * v;
+                std::memcpy(&v, value, sizeof(v));
+                appendf(out, "%p", v);
+                return at + sizeof(v);
+            }
+            }
+            return record.size;
+        }
+
+        // Frees heap copies of arguments that were never formatted
+        void releaseArgs(const LogRecord & record, std::size_t at)
+        {
+            while (at < record.size)
+            {
+                char * text = nullptr;
+                if (static_cast<LogArg>(record.payload[at]) == LogArg::HeapString)
+                    std::memcpy(&text, record.payload + at + 1, sizeof(text));
+
+                std::string ignored;
+                at = appendArg(ignored, record, at);
+                delete[] text;
+            }
+        }
+
+        void format(std::string & out, const Pending & pending, double nsPerTick)
+        {
+            const LogRecord & record = pending.record;
+            double seconds = static_cast<double>(record.time - logger.startTicks) * nsPerTick * 1e-9;
+            appendf(out, "[%12.6f] T%-2u %-5s ", seconds, pending.thread, level_names[static_cast<int>(record.level)]);
+
+            std::size_t at = 0;
+            for (const char * c = record.format; *c; ++c)
+            {
+                if (c[0] == '{' && c[1] == '}' && at < record.size)
+                {
+                    bool heap = static_cast<LogArg>(record.payload[at]) == LogArg::HeapString;
+                    char * text = nullptr;
+                    if (heap)
+                        std::memcpy(&text, record.payload + at + 1, sizeof(text));
+
+                    at = appendArg(out, record, at);
+                    delete[] text;
+                    ++c;
+                    continue;
+                }
+                out += *c;
+            }
+            releaseArgs(record, at);
+            out += '\n';
+        }
+
+        std::size_t drain()
+        {
+            std::lock_guard<std::mutex> drainLock(logger.drainMutex);
+            logger.batch.clear();
+            logger.text.clear();
+
+            {
+                std::lock_guard<std::mutex> registryLock(logger.registryMutex);
+                for (std::size_t i = 0; i < logger.rings.size(); ++i)
+                {
+                    LogRing & ring = *logger.rings[i];
+                    std::uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+                    std::uint32_t head = ring.head.load(std::memory_order_acquire);
+                    for (; tail != head; ++tail)
+                        logger.batch.push_back(Pending{ring.records[tail & (LOG_RING_RECORDS - 1)], static_cast<std::uint32_t>(i)});
+                    ring.tail.store(tail, std::memory_order_release);
+
+                    std::uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+                    if (dropped != logger.reportedDrops[i])
+                    {
+                        appendf(logger.text, "[log] T%zu dropped %llu records\n", i,
+                                static_cast<unsigned long long>(dropped - logger.reportedDrops[i]));
+                        logger.reportedDrops[i] = dropped;
+                    }
+                }
+            }
+
+            if (logger.batch.empty() && logger.text.empty())
+                return 0;
+
+            // Each ring is in order already; interleave the threads by time
+            std::stable_sort(logger.batch.begin(), logger.batch.end(),
+                             [](const Pending & a, const Pending & b) { return a.record.time < b.record.time; });
+
+            double nsPerTick = CycleClock::NanosecondsPerTick();
+            for (auto const & pending : logger.batch)
+                format(logger.text, pending, nsPerTick);
+
+            std::fwrite(logger.text.data(), 1, logger.text.size(), logger.output);
+            std::fflush(logger.output);
+            return logger.batch.size();
+        }
+
+        void run()
+        {
+            while (logger.running.load(std::memory_order_acquire))
+            {
+                if (drain() == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            drain();
+        }
+    } // namespace
+
+    namespace detail
+    {
+        LogRing * registerRing()
+        {
+            std::lock_guard<std::mutex> lock(logger.registryMutex);
+            if (logger.rings.empty())
+                logger.startTicks = CycleClock::Now();
+
+            logger.rings.push_back(std::make_unique<LogRing>());
+            logger.reportedDrops.push_back(0);
+
+            if (!logger.running.exchange(true))
+                logger.worker = std::thread(run);
+
+            return logger.rings.back().get();
+        }
+    } // namespace detail
+
+    void SetOutput(std::FILE * file)
+    {
+        Flush();
+        std::lock_guard<std::mutex> lock(logger.drainMutex);
+        logger.output = file ? file : stdout;
+    }
+
+    void Flush()
+    {
+        drain();
+    }
+
+    void Shutdown()
+    {
+        if (logger.running.exchange(false) && logger.worker.joinable())
+            logger.worker.join();
+        drain();
+    }
+}
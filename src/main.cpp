@@ -1,9 +1,12 @@
 #include <game.h>
+#include <log.h>
 
 int main(int _argc, char * _argv[])
 {
     Game & game = Game::Instance();
-    game.Run();
+    game.Run(GameConfig::FromArgs(_argc, _argv));
     game.Close();
-    return 0;
+    int code = game.ExitCode();
+    Log::Shutdown();
+    return code;
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include <parallel.h>
+#include <profiler.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace Parallel
+{
+    namespace
+    {
+        struct Pool
+        {
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable finished;
+
+            const std::function<void(unsigned int)> * job = nullptr;
+            unsigned int count = 0;
+            unsigned long generation = 0;
+            std::atomic<unsigned int> next{0};
+            unsigned int done = 0;
+            unsigned int active = 0;
+            bool stopping = false;
+
+            Pool()
+            {
+                unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+                for (unsigned int i = 0; i + 1 < hardware; ++i)
+                    workers.emplace_back([this] { workerLoop(); });
+            }
+
+            ~Pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for (auto & worker : workers)
+                    worker.join();
+            }
+
+            // Claims tasks until none are left; returns how many it ran
+            unsigned int drain(const std::function<void(unsigned int)> & fn, unsigned int total)
+            {
+                PROFILE_SCOPE("Parallel::drain");
+                unsigned int ran = 0;
+                for (unsigned int i = next.fetch_add(1); i < total; i = next.fetch_add(1))
+                {
+                    fn(i);
+                    ++ran;
+                }
+                return ran;
+            }
+
+            void workerLoop()
+            {
+                unsigned long seen = 0;
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true)
+                {
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+
+                    // Woken after the Run() that bumped generation returned
+                    seen = generation;
+                    if (!job)
+                        continue;
+
+                    const std::function<void(unsigned int)> * fn = job;
+                    unsigned int total = count;
+                    ++active;
+                    lock.unlock();
+
+                    unsigned int ran = drain(*fn, total);
+
+                    lock.lock();
+                    --active;
+                    done += ran;
+                    if (done == count && active == 0)
+                        finished.notify_one();
+                }
+            }
+
+            void run(unsigned int total, const std::function<void(unsigned int)> & fn)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job = &fn;
+                    count = total;
+                    done = 0;
+                    next.store(0);
+                    ++generation;
+                }
+                wake.notify_all();
+
+                unsigned int ran = drain(fn, total);
+
+                // Waiting for active == 0 keeps a late worker from claiming
+                // indices of the next Run() with this job's function
+                std::unique_lock<std::mutex> lock(mutex);
+                done += ran;
+                finished.wait(lock, [&] { return done == count && active == 0; });
+                job = nullptr;
+            }
+        };
+
+        Pool & pool()
+        {
+            static Pool instance;
+            return instance;
+        }
+    }
+
+    unsigned int ThreadCount()
+    {
+        return static_cast<unsigned int>(pool().workers.size()) + 1;
+    }
+
+    void Run(unsigned int count, const std::function<void(unsigned int task)> & task)
+    {
+        if (count == 0)
+            return;
+
+        if (count == 1)
+        {
+            task(0);
+            return;
+        }
+
+        pool().run(count, task);
+    }
+
+    unsigned int RangeCount(std::size_t size, std::size_t minRange)
+    {
+        std::size_t ranges = std::min<std::size_t>(ThreadCount(), size / std::max<std::size_t>(minRange, 1));
+        return static_cast<unsigned int>(std::max<std::size_t>(ranges, 1));
+    }
+
+    void For(std::size_t size, std::size_t minRange,
+             const std::function<void(std::size_t begin, std::size_t end, unsigned int task)> & fn)
+    {
+        unsigned int ranges = RangeCount(size, minRange);
+        Run(ranges, [&](unsigned int task) {
+            std::size_t begin = size * task / ranges;
+            std::size_t end = size * (task + 1) / ranges;
+            fn(begin, end, task);
+        });
+    }
+}
@@ -0,0 +1,122 @@
+#include <profiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler
+{
+    namespace
+    {
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ProfileRing>> rings;
+            // Trace timestamps count from here
+            std::uint64_t epoch = CycleClock::Now();
+
+            // Written and read by the frame marking thread only
+            std::uint64_t frameStarts[PROFILER_MAX_FRAMES] = {};
+            std::uint64_t frameCount = 0;
+        };
+
+        Registry registry;
+
+        // Events of one ring that are at or after from, oldest first
+        void snapshot(const ProfileRing & ring, std::uint64_t from, std::vector<ProfileEvent> & out)
+        {
+            std::uint64_t head = ring.head.load(std::memory_order_acquire);
+            std::uint64_t first = head > PROFILER_RING_EVENTS ? head - PROFILER_RING_EVENTS : 0;
+
+            std::size_t start = out.size();
+            for (std::uint64_t i = first; i < head; ++i)
+                out.push_back(ring.events[i & (PROFILER_RING_EVENTS - 1)]);
+
+            // The owner kept writing while we copied. Whatever it reached
+            // since may have been overwritten, including the slot it is on.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::uint64_t now = ring.head.load(std::memory_order_relaxed);
+            std::uint64_t valid = now >= PROFILER_RING_EVENTS ? now - PROFILER_RING_EVENTS + 1 : 0;
+            std::size_t torn = valid > first ? static_cast<std::size_t>(std::min(valid - first, head - first)) : 0;
+            out.erase(out.begin() + start, out.begin() + start + torn);
+
+            out.erase(std::remove_if(out.begin() + start, out.end(),
+                                     [from](const ProfileEvent & event) { return event.begin < from; }),
+                      out.end());
+        }
+    } // namespace
+
+    namespace detail
+    {
+        ProfileRing * registerRing(const char * name)
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.rings.push_back(std::make_unique<ProfileRing>());
+            registry.rings.back()->thread = static_cast<std::uint32_t>(registry.rings.size() - 1);
+            registry.rings.back()->name = name;
+            return registry.rings.back().get();
+        }
+    } // namespace detail
+
+    ProfileRing * CreateTrack(const char * name)
+    {
+        return detail::registerRing(name);
+    }
+
+    void FrameMark()
+    {
+        std::uint64_t now = CycleClock::Now();
+        if (registry.frameCount > 0)
+            detail::record("Frame", registry.frameStarts[(registry.frameCount - 1) % PROFILER_MAX_FRAMES], now);
+
+        registry.frameStarts[registry.frameCount % PROFILER_MAX_FRAMES] = now;
+        ++registry.frameCount;
+    }
+
+    bool WriteChromeTrace(const std::string & path, std::size_t frames)
+    {
+        // The oldest of the last frames that are still remembered
+        std::uint64_t from = 0;
+        std::uint64_t kept = std::min<std::uint64_t>({frames, registry.frameCount, PROFILER_MAX_FRAMES});
+        if (kept > 0)
+            from = registry.frameStarts[(registry.frameCount - kept) % PROFILER_MAX_FRAMES];
+
+        std::FILE * file = std::fopen(path.c_str(), "w");
+        if (!file)
+            return false;
+
+        std::uint32_t self = detail::thread_ring ? detail::thread_ring->thread : ~0u;
+        double usPerTick = CycleClock::NanosecondsPerTick() * 1e-3;
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        bool first = true;
+        std::vector<ProfileEvent> events;
+
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto const & ring : registry.rings)
+        {
+            const char * name = ring->name ? ring->name : ring->thread == self ? "Main" : "Worker";
+            std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"name\":\"%s %u\"}}",
+                         first ? "" : ",", ring->thread, name, ring->thread);
+            first = false;
+
+            events.clear();
+            snapshot(*ring, from, events);
+            for (auto const & event : events)
+            {
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                                   "\"ts\":%.3f,\"dur\":%.3f}",
+                             event.name, ring->name ? ring->name : "CPU", ring->thread,
+                             static_cast<double>(event.begin - registry.epoch) * usPerTick,
+                             static_cast<double>(event.end - event.begin) * usPerTick);
+            }
+        }
+        std::fputs("\n]}\n", file);
+
+        bool written = !std::ferror(file);
+        return std::fclose(file) == 0 && written;
+    }
+}
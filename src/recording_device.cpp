@@ -0,0 +1,238 @@
+#include <recording_device.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    const std::vector<unsigned char> no_bytes;
+} // namespace
+
+void RecordingDevice::Reset()
+{
+    commands.clear();
+    counts.fill(0);
+    draws.clear();
+    indirect.clear();
+    uploadedBytes = 0;
+}
+
+const std::vector<unsigned char> & RecordingDevice::BufferBytes(GLuint buffer) const
+{
+    if (buffer == 0 || buffer > buffers.size())
+        return no_bytes;
+    return buffers[buffer - 1];
+}
+
+RenderDeviceCaps RecordingDevice::Caps()
+{
+    RenderDeviceCaps caps;
+    caps.storageAlignment = storageAlignment;
+    caps.executes = false;
+    return caps;
+}
+
+void RecordingDevice::record(RecordedOp op, GLenum target, GLuint object, GLuint index, GLintptr offset, GLsizeiptr size)
+{
+    commands.push_back(RecordedCommand{op, target, object, index, offset, size});
+    ++counts[static_cast<std::size_t>(op)];
+}
+
+std::vector<unsigned char> * RecordingDevice::bytes(GLuint buffer)
+{
+    if (buffer == 0 || buffer > buffers.size())
+        return nullptr;
+    return &buffers[buffer - 1];
+}
+
+void RecordingDevice::UseProgram(GLuint program)
+{
+    this->program = program;
+    record(RecordedOp::UseProgram, 0, program);
+}
+
+void RecordingDevice::BindVertexArray(GLuint vao)
+{
+    this->vao = vao;
+    record(RecordedOp::BindVertexArray, 0, vao);
+}
+
+void RecordingDevice::BindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_DRAW_INDIRECT_BUFFER)
+        indirectBuffer = buffer;
+    record(RecordedOp::BindBuffer, target, buffer);
+}
+
+void RecordingDevice::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    record(RecordedOp::BindBufferBase, target, buffer, index);
+}
+
+void RecordingDevice::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    record(RecordedOp::BindBufferRange, target, buffer, index, offset, size);
+}
+
+void RecordingDevice::ActiveTexture(GLenum unit)
+{
+    record(RecordedOp::ActiveTexture, 0, 0, unit - GL_TEXTURE0);
+}
+
+void RecordingDevice::BindTexture(GLenum target, GLuint texture)
+{
+    record(RecordedOp::BindTexture, target, texture);
+}
+
+void RecordingDevice::SetCapability(GLenum capability, bool enabled)
+{
+    record(enabled ? RecordedOp::Enable : RecordedOp::Disable, capability);
+}
+
+void RecordingDevice::ClearColor(float, float, float, float)
+{
+    record(RecordedOp::ClearColor);
+}
+
+GLuint RecordingDevice::CreateBuffer()
+{
+    buffers.emplace_back();
+    return static_cast<GLuint>(buffers.size());
+}
+
+void RecordingDevice::BufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum)
+{
+    std::vector<unsigned char> * storage = bytes(buffer);
+    if (storage)
+    {
+        storage->assign(size, 0);
+        if (data)
+            std::memcpy(storage->data(), data, size);
+    }
+
+    if (data)
+        uploadedBytes += size;
+    record(RecordedOp::BufferData, 0, buffer, 0, 0, size);
+}
+
+void RecordingDevice::BufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data)
+{
+    std::vector<unsigned char> * storage = bytes(buffer);
+    if (storage && offset + size <= static_cast<GLsizeiptr>(storage->size()))
+        std::memcpy(storage->data() + offset, data, size);
+
+    uploadedBytes += size;
+    record(RecordedOp::BufferSubData, 0, buffer, 0, offset, size);
+}
+
+void RecordingDevice::CopyBufferSubData(GLuint source, GLuint destination, GLintptr source_offset, GLintptr destination_offset, GLsizeiptr size)
+{
+    std::vector<unsigned char> * from = bytes(source);
+    std::vector<unsigned char> * to = bytes(destination);
+    if (from && to &&
+        source_offset + size <= static_cast<GLsizeiptr>(from->size()) &&
+        destination_offset + size <= static_cast<GLsizeiptr>(to->size()))
+        std::memmove(to->data() + destination_offset, from->data() + source_offset, size);
+
+    record(RecordedOp::CopyBufferSubData, 0, destination, source, destination_offset, size);
+}
+
+void * RecordingDevice::MapPersistent(GLuint buffer, GLsizeiptr size)
+{
+    // The storage is never resized while mapped, so the pointer stays valid
+    std::vector<unsigned char> * storage = bytes(buffer);
+    if (!storage)
+        return nullptr;
+    storage->assign(size, 0);
+    return storage->data();
+}
+
+void RecordingDevice::DeleteBuffer(GLuint buffer)
+{
+    std::vector<unsigned char> * storage = bytes(buffer);
+    if (storage)
+        std::vector<unsigned char>().swap(*storage);
+}
+
+void RecordingDevice::ProgramUniform(GLuint program, GLint location, GLenum type, const void *)
+{
+    record(RecordedOp::ProgramUniform, type, program, static_cast<GLuint>(location));
+}
+
+void RecordingDevice::Clear(GLbitfield mask)
+{
+    record(RecordedOp::Clear, mask);
+}
+
+void RecordingDevice::DispatchCompute(GLuint x, GLuint y, GLuint z)
+{
+    // Group counts go in index, offset and size
+    record(RecordedOp::DispatchCompute, 0, program, x, y, z);
+}
+
+void RecordingDevice::Barrier(GLbitfield barriers)
+{
+    record(RecordedOp::Barrier, barriers);
+}
+
+void RecordingDevice::MultiDrawElementsIndirect(GLenum mode, GLenum, GLintptr offset, GLsizei count, GLsizei stride)
+{
+    record(RecordedOp::MultiDrawElementsIndirect, mode, indirectBuffer, 0, offset, count);
+
+    RecordedDraw draw{program, vao, mode, static_cast<std::uint32_t>(indirect.size()), 0};
+
+    if (stride == 0)
+        stride = sizeof(DrawElementsIndirectCommand);
+
+    const std::vector<unsigned char> & source = BufferBytes(indirectBuffer);
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        GLintptr at = offset + i * stride;
+        if (at + static_cast<GLintptr>(sizeof(DrawElementsIndirectCommand)) > static_cast<GLintptr>(source.size()))
+            break;
+
+        DrawElementsIndirectCommand command;
+        std::memcpy(&command, source.data() + at, sizeof(command));
+        indirect.push_back(command);
+        ++draw.commandCount;
+    }
+
+    draws.push_back(draw);
+}
+
+void RecordingDevice::Finish()
+{
+    record(RecordedOp::Finish);
+}
+
+GLsync RecordingDevice::FenceSync()
+{
+    record(RecordedOp::FenceSync);
+    return nullptr;
+}
+
+void RecordingDevice::CreateQueries(GLsizei count, GLuint * queries)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        queryTimes.push_back(0);
+        queries[i] = static_cast<GLuint>(queryTimes.size());
+    }
+}
+
+void RecordingDevice::QueryTimestamp(GLuint query)
+{
+    record(RecordedOp::QueryTimestamp, GL_TIMESTAMP, query);
+    if (query > 0 && query <= queryTimes.size())
+        queryTimes[query - 1] = static_cast<GLuint64>(Timestamp());
+}
+
+GLuint64 RecordingDevice::QueryResult(GLuint query)
+{
+    return query > 0 && query <= queryTimes.size() ? queryTimes[query - 1] : 0;
+}
+
+GLint64 RecordingDevice::Timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,371 @@
+#include <render_device.h>
+#include <gl_state.h>
+
+#include <algorithm>
+#include <log.h>
+
+namespace
+{
+    GLDevice gl_device;
+    RenderDevice * current_device = &gl_device;
+
+    const char * stageName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_VERTEX_SHADER:
+            return "VERTEX";
+        case GL_FRAGMENT_SHADER:
+            return "FRAGMENT";
+        case GL_COMPUTE_SHADER:
+            return "COMPUTE";
+        default:
+            return "UNKNOWN";
+        }
+    }
+} // namespace
+
+RenderDevice & RenderDevice::Current()
+{
+    return *current_device;
+}
+
+void RenderDevice::SetCurrent(RenderDevice * device)
+{
+    current_device = device ? device : &gl_device;
+    GLState::Invalidate();
+}
+
+RenderDeviceCaps GLDevice::Caps()
+{
+    RenderDeviceCaps caps;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &caps.storageAlignment);
+    caps.executes = true;
+    return caps;
+}
+
+GLenum GLDevice::GetError()
+{
+    return glGetError();
+}
+
+void GLDevice::UseProgram(GLuint program)
+{
+    glUseProgram(program);
+}
+
+void GLDevice::BindVertexArray(GLuint vao)
+{
+    glBindVertexArray(vao);
+}
+
+void GLDevice::BindBuffer(GLenum target, GLuint buffer)
+{
+    glBindBuffer(target, buffer);
+}
+
+void GLDevice::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    glBindBufferBase(target, index, buffer);
+}
+
+void GLDevice::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLDevice::ActiveTexture(GLenum unit)
+{
+    glActiveTexture(unit);
+}
+
+void GLDevice::BindTexture(GLenum target, GLuint texture)
+{
+    glBindTexture(target, texture);
+}
+
+void GLDevice::SetCapability(GLenum capability, bool enabled)
+{
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLDevice::ClearColor(float r, float g, float b, float a)
+{
+    glClearColor(r, g, b, a);
+}
+
+GLuint GLDevice::CreateBuffer()
+{
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    return buffer;
+}
+
+void GLDevice::BufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum usage)
+{
+    glNamedBufferData(buffer, size, data, usage);
+}
+
+void GLDevice::BufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data)
+{
+    glNamedBufferSubData(buffer, offset, size, data);
+}
+
+void GLDevice::CopyBufferSubData(GLuint source, GLuint destination, GLintptr source_offset, GLintptr destination_offset, GLsizeiptr size)
+{
+    glCopyNamedBufferSubData(source, destination, source_offset, destination_offset, size);
+}
+
+void * GLDevice::MapPersistent(GLuint buffer, GLsizeiptr size)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glNamedBufferStorage(buffer, size, nullptr, flags);
+    return glMapNamedBufferRange(buffer, 0, size, flags);
+}
+
+void GLDevice::Unmap(GLuint buffer)
+{
+    glUnmapNamedBuffer(buffer);
+}
+
+void GLDevice::DeleteBuffer(GLuint buffer)
+{
+    glDeleteBuffers(1, &buffer);
+}
+
+GLuint GLDevice::CreateVertexArray()
+{
+    GLuint vao;
+    glCreateVertexArrays(1, &vao);
+    return vao;
+}
+
+void GLDevice::VertexArrayAttrib(GLuint vao, GLuint index, GLint size, GLenum type, GLuint offset, GLuint binding)
+{
+    glEnableVertexArrayAttrib(vao, index);
+    glVertexArrayAttribFormat(vao, index, size, type, GL_FALSE, offset);
+    glVertexArrayAttribBinding(vao, index, binding);
+}
+
+void GLDevice::VertexArrayVertexBuffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride)
+{
+    glVertexArrayVertexBuffer(vao, binding, buffer, offset, stride);
+}
+
+void GLDevice::VertexArrayElementBuffer(GLuint vao, GLuint buffer)
+{
+    glVertexArrayElementBuffer(vao, buffer);
+}
+
+void GLDevice::DeleteVertexArray(GLuint vao)
+{
+    glDeleteVertexArrays(1, &vao);
+}
+
+GLuint GLDevice::CreateTexture2D(GLsizei width, GLsizei height, GLenum format, const void * pixels)
+{
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+        ++levels;
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTextureStorage2D(texture, levels, format == GL_RGBA ? GL_RGBA8 : GL_RGB8, width, height);
+    glTextureSubImage2D(texture, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+    glGenerateTextureMipmap(texture);
+
+    return texture;
+}
+
+void GLDevice::DeleteTexture(GLuint texture)
+{
+    glDeleteTextures(1, &texture);
+}
+
+GLuint GLDevice::CreateProgram(const ShaderStage * stages, int count)
+{
+    int success;
+    char info_log[512];
+
+    GLuint shader_program = glCreateProgram();
+    std::vector<GLuint> shaders;
+    for (int i = 0; i < count; ++i)
+    {
+        GLuint shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &stages[i].source, NULL);
+        glCompileShader(shader);
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, 512, NULL, info_log);
+            LOG_ERROR("ERROR::SHADER::{}::COMPILATION_FAILED\n{}", stageName(stages[i].type), info_log);
+        }
+
+        glAttachShader(shader_program, shader);
+        shaders.push_back(shader);
+    }
+
+    glLinkProgram(shader_program);
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(shader_program, 512, NULL, info_log);
+        LOG_ERROR("ERROR::SHADER::PROGRAM::LINKING_FAILED\n{}", info_log);
+    }
+
+    // Delete shaders as they're linked into our program now and no longer necessary
+    for (GLuint shader : shaders)
+        glDeleteShader(shader);
+
+    return shader_program;
+}
+
+std::vector<UniformInfo> GLDevice::ActiveUniforms(GLuint program)
+{
+    std::vector<UniformInfo> uniforms;
+
+    GLint count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+
+    GLint max_name_length = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_name_length);
+    std::string name(max_name_length, '\0');
+
+    const GLenum properties[] = {GL_BLOCK_INDEX, GL_TYPE, GL_LOCATION};
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLint values[3];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 3, properties, 3, NULL, values);
+
+        // Uniform block members have no location of their own
+        if (values[0] != -1 || values[2] < 0)
+            continue;
+
+        GLsizei length = 0;
+        glGetProgramResourceName(program, GL_UNIFORM, i, max_name_length, &length, &name[0]);
+        uniforms.push_back(UniformInfo{std::string(name.data(), length), static_cast<GLenum>(values[1]), values[2]});
+    }
+
+    return uniforms;
+}
+
+void GLDevice::ProgramUniform(GLuint program, GLint location, GLenum type, const void * value)
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+        glProgramUniform1fv(program, location, 1, static_cast<const GLfloat *>(value));
+        break;
+    case GL_INT:
+        glProgramUniform1iv(program, location, 1, static_cast<const GLint *>(value));
+        break;
+    case GL_UNSIGNED_INT:
+        glProgramUniform1uiv(program, location, 1, static_cast<const GLuint *>(value));
+        break;
+    case GL_FLOAT_VEC3:
+        glProgramUniform3fv(program, location, 1, static_cast<const GLfloat *>(value));
+        break;
+    case GL_FLOAT_VEC4:
+        glProgramUniform4fv(program, location, 1, static_cast<const GLfloat *>(value));
+        break;
+    case GL_FLOAT_MAT4:
+        glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, static_cast<const GLfloat *>(value));
+        break;
+    default:
+        LOG_ERROR("ERROR::SHADER::UNIFORM::UNSUPPORTED_TYPE {}", type);
+        break;
+    }
+}
+
+void GLDevice::DeleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+}
+
+void GLDevice::Clear(GLbitfield mask)
+{
+    glClear(mask);
+}
+
+void GLDevice::DispatchCompute(GLuint x, GLuint y, GLuint z)
+{
+    glDispatchCompute(x, y, z);
+}
+
+void GLDevice::Barrier(GLbitfield barriers)
+{
+    glMemoryBarrier(barriers);
+}
+
+void GLDevice::MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei count, GLsizei stride)
+{
+    glMultiDrawElementsIndirect(mode, type, (void *)offset, count, stride);
+}
+
+void GLDevice::Finish()
+{
+    glFinish();
+}
+
+GLsync GLDevice::FenceSync()
+{
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GLDevice::WaitSync(GLsync fence)
+{
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, 0, 1000000);
+}
+
+void GLDevice::DeleteSync(GLsync fence)
+{
+    glDeleteSync(fence);
+}
+
+void GLDevice::CreateQueries(GLsizei count, GLuint * queries)
+{
+    glCreateQueries(GL_TIMESTAMP, count, queries);
+}
+
+void GLDevice::DeleteQueries(GLsizei count, const GLuint * queries)
+{
+    glDeleteQueries(count, queries);
+}
+
+void GLDevice::QueryTimestamp(GLuint query)
+{
+    glQueryCounter(query, GL_TIMESTAMP);
+}
+
+bool GLDevice::QueryAvailable(GLuint query)
+{
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != GL_FALSE;
+}
+
+GLuint64 GLDevice::QueryResult(GLuint query)
+{
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    return result;
+}
+
+GLint64 GLDevice::Timestamp()
+{
+    GLint64 now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &now);
+    return now;
+}
@@ -0,0 +1,69 @@
+#include <render_queue.h>
+#include <profiler.h>
+
+#include <array>
+#include <utility>
+
+static std::uint64_t fieldBits(std::uint32_t value, int bits)
+{
+    return static_cast<std::uint64_t>(value) & ((1ull << bits) - 1);
+}
+
+std::uint64_t RenderQueue::MakeKey(std::uint32_t layer, std::uint32_t program, std::uint32_t material, std::uint32_t mesh, float depth)
+{
+    if (depth < 0.0f)
+        depth = 0.0f;
+    if (depth > 1.0f)
+        depth = 1.0f;
+    std::uint32_t quantized = static_cast<std::uint32_t>(depth * ((1u << SORT_KEY_DEPTH_BITS) - 1));
+
+    std::uint64_t key = fieldBits(layer, SORT_KEY_LAYER_BITS);
+    key = (key << SORT_KEY_PROGRAM_BITS) | fieldBits(program, SORT_KEY_PROGRAM_BITS);
+    key = (key << SORT_KEY_MATERIAL_BITS) | fieldBits(material, SORT_KEY_MATERIAL_BITS);
+    key = (key << SORT_KEY_MESH_BITS) | fieldBits(mesh, SORT_KEY_MESH_BITS);
+    key = (key << SORT_KEY_DEPTH_BITS) | fieldBits(quantized, SORT_KEY_DEPTH_BITS);
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    PROFILE_SCOPE("RenderQueue::Sort");
+    const std::size_t count = packets.size();
+    if (count < 2)
+        return;
+
+    // One read pass builds the histograms for all eight digits
+    std::array<std::array<std::size_t, 256>, 8> histograms{};
+    for (auto const & packet : packets)
+        for (int pass = 0; pass < 8; ++pass)
+            ++histograms[pass][(packet.key >> (pass * 8)) & 0xFF];
+
+    scratch.resize(count);
+    std::vector<DrawPacket> * src = &packets;
+    std::vector<DrawPacket> * dst = &scratch;
+
+    for (int pass = 0; pass < 8; ++pass)
+    {
+        auto & histogram = histograms[pass];
+        int shift = pass * 8;
+
+        if (histogram[((*src)[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        std::size_t offset = 0;
+        for (auto & bucket : histogram)
+        {
+            std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        for (auto const & packet : *src)
+            (*dst)[histogram[(packet.key >> shift) & 0xFF]++] = packet;
+
+        std::swap(src, dst);
+    }
+
+    if (src != &packets)
+        packets.swap(scratch);
+}
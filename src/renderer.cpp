@@ -0,0 +1,360 @@
+#include <renderer.h>
+#include <uniform_table.h>
+#include <log.h>
+#include <profiler.h>
+
+#include <cstring>
+#include <algorithm>
+
+// Initial per-frame instance and command storage, grown on demand
+#define INSTANCE_STREAM_SIZE (1024 * 1024)
+#define COMMAND_STREAM_SIZE (64 * 1024)
+
+namespace
+{
+    constexpr std::uint32_t INSTANCE_COUNT_UNIFORM = UniformHash("instanceCount");
+} // namespace
+
+void Renderer::Init()
+{
+    RenderDevice & device = RenderDevice::Current();
+    RenderDeviceCaps caps = device.Caps();
+    storageAlignment = caps.storageAlignment;
+    if (!caps.executes)
+        gpuCulling = false;
+
+    instanceStream.Init(GL_SHADER_STORAGE_BUFFER, INSTANCE_STREAM_SIZE);
+    commandStream.Init(GL_DRAW_INDIRECT_BUFFER, COMMAND_STREAM_SIZE);
+
+    cullShader = ResourceLoader::LoadComputeShader("shaders/cull.glsl");
+    cullInstanceCount = cullShader.Get().uniforms.Find(INSTANCE_COUNT_UNIFORM);
+    visibleBuffer = device.CreateBuffer();
+    visibleCapacity = 0;
+
+    cameraBuffer = device.CreateBuffer();
+    device.BufferData(cameraBuffer, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    GLState::BindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, cameraBuffer);
+    cameraVersion = 0;
+
+    gpuProfiler.Init();
+}
+
+void Renderer::Shutdown()
+{
+    gpuProfiler.Shutdown();
+
+    queue.Clear();
+    instances.clear();
+    commands.clear();
+    buckets.clear();
+
+    instanceStream.Shutdown();
+    commandStream.Shutdown();
+
+    cullShader = ResourceLoader::ShaderHandle();
+    cullInstanceCount = UniformTable::NOT_FOUND;
+    if (visibleBuffer)
+        GLState::DeleteBuffers(1, &visibleBuffer);
+    visibleBuffer = 0;
+    visibleCapacity = 0;
+
+    if (cameraBuffer)
+        GLState::DeleteBuffers(1, &cameraBuffer);
+    cameraBuffer = 0;
+}
+
+void Renderer::BeginFrame()
+{
+    PROFILE_SCOPE("Renderer::BeginFrame");
+    stats = RenderStats{};
+    frameStartState = GLState::FrameCounters();
+    frameStartUniforms = UniformTable::TotalUploads();
+
+    queue.Clear();
+    instances.clear();
+
+    instanceStream.BeginFrame();
+    commandStream.BeginFrame();
+
+    gpuProfiler.BeginFrame();
+}
+
+void Renderer::Submit(const ResourceLoader::MeshHandle & mesh, const ResourceLoader::ShaderHandle & shader, const glm::mat4 & model, const glm::vec4 & color, std::uint32_t layer, std::uint32_t material)
+{
+    // View distance of the origin, so runs are drawn front to back
+    float depth = (viewProjection * model[3]).w / farPlane;
+
+    DrawPacket packet;
+    packet.key = RenderQueue::MakeKey(layer, shader.Id(), material, mesh.Id(), depth);
+    packet.mesh = mesh.Id();
+    packet.shader = shader.Id();
+    packet.material = material;
+    packet.instance = static_cast<std::uint32_t>(instances.size());
+
+    queue.Push(packet);
+    instances.push_back(InstanceData{model, color});
+}
+
+void Renderer::SetCamera(Camera & camera)
+{
+    camera.UpdateMatrices();
+    viewProjection = camera.viewProjection;
+    frustum = camera.frustum;
+    farPlane = camera.farPlane;
+
+    if (camera.version == cameraVersion)
+        return;
+
+    CameraBlock block{camera.view, camera.projection, camera.viewProjection, glm::vec4(camera.position, 1.0f), {}};
+    std::copy(std::begin(camera.frustum.planes), std::end(camera.frustum.planes), block.frustumPlanes);
+
+    RenderDevice::Current().BufferSubData(cameraBuffer, 0, sizeof(CameraBlock), &block);
+    stats.bytesUploaded += sizeof(CameraBlock);
+    cameraVersion = camera.version;
+}
+
+void Renderer::Flush()
+{
+    PROFILE_SCOPE("Renderer::Flush");
+    GPU_PROFILE_SCOPE(gpuProfiler, "Renderer::Flush");
+
+    queue.Sort();
+    buildCommands();
+    if (uploadInstances() && uploadCommands())
+    {
+        if (gpuCulling)
+            cullInstances();
+
+        drawBuckets();
+
+        if (gpuCulling && cullCrossCheck)
+            crossCheckCulling();
+    }
+
+    // Fence this frame's regions of the rings
+    instanceStream.EndFrame();
+    commandStream.EndFrame();
+
+    countState();
+}
+
+void Renderer::countState()
+{
+    GLState::Counters const & now = GLState::FrameCounters();
+    stats.programBinds = now.programBinds - frameStartState.programBinds;
+    stats.vaoBinds = now.vaoBinds - frameStartState.vaoBinds;
+    stats.textureBinds = now.textureBinds - frameStartState.textureBinds;
+    stats.bufferBinds = now.bufferBinds - frameStartState.bufferBinds;
+    stats.elidedCalls = now.elided - frameStartState.elided;
+    stats.uniformUploads = static_cast<unsigned int>(UniformTable::TotalUploads() - frameStartUniforms);
+}
+
+void Renderer::buildCommands()
+{
+    PROFILE_SCOPE("Renderer::buildCommands");
+    commands.clear();
+    buckets.clear();
+    cullData.clear();
+
+    auto const & packets = queue.Packets();
+    std::size_t first = 0;
+    while (first < packets.size())
+    {
+        // Extend the run while the mesh and state stay the same. Ids are
+        // compared in full since the key only holds their low bits.
+        const DrawPacket & head = packets[first];
+        std::size_t last = first + 1;
+        while (last < packets.size() &&
+               RenderQueue::DrawBits(packets[last].key) == RenderQueue::DrawBits(head.key) &&
+               packets[last].shader == head.shader &&
+               packets[last].mesh == head.mesh &&
+               packets[last].material == head.material)
+            ++last;
+
+        auto const & mesh = ResourceLoader::MeshHandle::Resolve(head.mesh);
+
+        // Start a new bucket whenever anything but the mesh range changes
+        bool sameBucket = !buckets.empty() &&
+                          RenderQueue::StateBits(packets[first - 1].key) == RenderQueue::StateBits(head.key) &&
+                          packets[first - 1].shader == head.shader &&
+                          packets[first - 1].material == head.material &&
+                          buckets.back().vao == mesh.VAO;
+        if (!sameBucket)
+            buckets.push_back(Bucket{head.shader, mesh.VAO, static_cast<std::uint32_t>(commands.size()), 0});
+
+        // Instances are uploaded in sorted packet order, so packet i is instance i
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<GLuint>(mesh.indexCount);
+        command.instanceCount = static_cast<GLuint>(last - first);
+        command.firstIndex = mesh.firstIndex;
+        command.baseVertex = mesh.baseVertex;
+        command.baseInstance = static_cast<GLuint>(first);
+        commands.push_back(command);
+        ++buckets.back().commandCount;
+
+        if (gpuCulling)
+        {
+            GLuint commandIndex = static_cast<GLuint>(commands.size() - 1);
+            for (std::size_t i = first; i < last; ++i)
+                cullData.push_back(CullData{mesh.bounds, commandIndex, {0, 0, 0}});
+        }
+
+        stats.instances += command.instanceCount;
+        stats.triangles += std::uint64_t(command.count / 3) * command.instanceCount;
+        first = last;
+    }
+
+    stats.commands = static_cast<unsigned int>(commands.size());
+}
+
+bool Renderer::uploadCommands()
+{
+    if (commands.empty())
+        return false;
+
+    // The culling pass binds this range as an SSBO, so it needs that alignment
+    GLsizeiptr size = static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand));
+    commandStream.Reserve(size + storageAlignment);
+
+    commandRange = commandStream.Allocate(size, storageAlignment);
+    if (!commandRange.Valid())
+        return false;
+
+    std::memcpy(commandRange.data, commands.data(), size);
+    stats.bytesUploaded += size;
+
+    // The culling pass counts visible instances back in
+    if (gpuCulling)
+    {
+        auto * dst = static_cast<DrawElementsIndirectCommand *>(commandRange.data);
+        for (std::size_t i = 0; i < commands.size(); ++i)
+            dst[i].instanceCount = 0;
+    }
+    return true;
+}
+
+void Renderer::cullInstances()
+{
+    GPU_PROFILE_SCOPE(gpuProfiler, "Renderer::cullInstances");
+    RenderDevice & device = RenderDevice::Current();
+
+    GLsizeiptr size = instanceRange.size;
+    if (size > visibleCapacity)
+    {
+        visibleCapacity = size * 2;
+        device.BufferData(visibleBuffer, visibleCapacity, nullptr, GL_DYNAMIC_COPY);
+    }
+
+    auto & shader = cullShader.Get();
+    GLState::UseProgram(shader.program);
+    shader.uniforms.Set(cullInstanceCount, static_cast<unsigned int>(instances.size()));
+
+    GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_INSTANCES_BINDING, instanceStream.Buffer(), instanceRange.offset, instanceRange.size);
+    GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_DATA_BINDING, instanceStream.Buffer(), cullRange.offset, cullRange.size);
+    GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_COMMANDS_BINDING, commandStream.Buffer(), commandRange.offset, commandRange.size);
+    GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING, visibleBuffer, 0, size);
+
+    GLuint groups = static_cast<GLuint>((instances.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+    device.DispatchCompute(groups, 1, 1);
+
+    // Make the compacted instances and counts visible to the draws
+    device.Barrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void Renderer::crossCheckCulling()
+{
+    RenderDevice & device = RenderDevice::Current();
+    device.Barrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    device.Finish();
+
+    // Same sphere transform and plane test as cull.glsl, on the CPU
+    std::vector<GLuint> expected(commands.size(), 0);
+    InstanceData const * sorted = static_cast<InstanceData const *>(instanceRange.data);
+    for (std::size_t i = 0; i < cullData.size(); ++i)
+    {
+        glm::mat4 const & model = sorted[i].model;
+        glm::vec4 const & sphere = cullData[i].sphere;
+
+        glm::vec3 center(model * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+        if (frustum.IntersectsSphere(center, sphere.w * scale))
+            ++expected[cullData[i].command];
+    }
+
+    auto const * gpu = static_cast<DrawElementsIndirectCommand const *>(commandRange.data);
+    for (std::size_t i = 0; i < commands.size(); ++i)
+    {
+        if (gpu[i].instanceCount != expected[i])
+        {
+            ++stats.cullMismatches;
+            LOG_WARN("Culling mismatch in command {}: GPU {}, CPU {}", i, gpu[i].instanceCount, expected[i]);
+        }
+    }
+}
+
+void Renderer::drawBuckets()
+{
+    PROFILE_SCOPE("Renderer::drawBuckets");
+    GPU_PROFILE_SCOPE(gpuProfiler, "Renderer::drawBuckets");
+    // After culling the draws read the compacted instances, already bound
+    if (!gpuCulling)
+        GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING, instanceStream.Buffer(), instanceRange.offset, instanceRange.size);
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream.Buffer());
+
+    RenderDevice & device = RenderDevice::Current();
+    std::uint32_t boundShader = ResourceLoader::ShaderHandle::INVALID;
+    GLuint boundVAO = 0;
+
+    for (auto const & bucket : buckets)
+    {
+        if (bucket.shader != boundShader)
+        {
+            GLState::UseProgram(ResourceLoader::ShaderHandle::Resolve(bucket.shader).program);
+            boundShader = bucket.shader;
+        }
+
+        if (bucket.vao != boundVAO)
+        {
+            GLState::BindVertexArray(bucket.vao);
+            boundVAO = bucket.vao;
+        }
+
+        GLintptr offset = commandRange.offset + bucket.firstCommand * sizeof(DrawElementsIndirectCommand);
+        device.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, bucket.commandCount, 0);
+        ++stats.drawCalls;
+    }
+}
+
+bool Renderer::uploadInstances()
+{
+    PROFILE_SCOPE("Renderer::uploadInstances");
+    if (instances.empty())
+        return false;
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(instances.size() * sizeof(InstanceData));
+    GLsizeiptr cullSize = static_cast<GLsizeiptr>(cullData.size() * sizeof(CullData));
+    instanceStream.Reserve(size + cullSize + 2 * storageAlignment);
+
+    instanceRange = instanceStream.Allocate(size, storageAlignment);
+    if (!instanceRange.Valid())
+        return false;
+
+    // Gather instances into sorted packet order straight inside the mapped
+    // ring, so packet i is instance i
+    InstanceData * dst = static_cast<InstanceData *>(instanceRange.data);
+    for (auto const & packet : queue.Packets())
+        *dst++ = instances[packet.instance];
+    stats.bytesUploaded += size;
+
+    if (gpuCulling)
+    {
+        cullRange = instanceStream.Allocate(cullSize, storageAlignment);
+        if (!cullRange.Valid())
+            return false;
+        std::memcpy(cullRange.data, cullData.data(), cullSize);
+        stats.bytesUploaded += cullSize;
+    }
+
+    return true;
+}
@@ -1,7 +1,288 @@
 #include "resource_loader.h"
+#include "log.h"
+#include "profiler.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 namespace ResourceLoader
 {
+    namespace
+    {
+        template <typename T>
+        struct AssetCache
+        {
+            struct Entry
+            {
+                T asset;
+                std::string key;
+                std::uint32_t refs = 0;
+            };
+
+            std::vector<Entry> entries;
+            std::vector<std::uint32_t> freeSlots;
+            std::unordered_map<std::string, std::uint32_t> lookup;
+
+            // Returns the slot for key, or INVALID if it has not been loaded
+            std::uint32_t find(const std::string & key) const
+            {
+                auto it = lookup.find(key);
+                return it == lookup.end() ? AssetHandle<T>::INVALID : it->second;
+            }
+
+            std::uint32_t insert(const std::string & key, const T & asset)
+            {
+                std::uint32_t id;
+                if (!freeSlots.empty())
+                {
+                    id = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+                else
+                {
+                    id = static_cast<std::uint32_t>(entries.size());
+                    entries.emplace_back();
+                }
+
+                entries[id] = Entry{asset, key, 0};
+                lookup[key] = id;
+                return id;
+            }
+        };
+
+        // One VAO with a growable vertex and index buffer holding every mesh.
+        // Released ranges are reclaimed once no mesh is alive.
+        struct MeshPool
+        {
+            GLuint VAO = 0;
+            GLuint VBO = 0;
+            GLuint EBO = 0;
+            GLsizeiptr vertexCapacity = 0;
+            GLsizeiptr vertexUsed = 0;
+            GLsizeiptr indexCapacity = 0;
+            GLsizeiptr indexUsed = 0;
+            std::uint32_t liveMeshes = 0;
+        };
+
+        constexpr GLsizei POOL_VERTEX_STRIDE = 3 * sizeof(float);
+        constexpr GLsizeiptr POOL_INITIAL_BYTES = 64 * 1024;
+
+        MeshPool mesh_pool;
+
+        // Grows buffer to hold at least required bytes, keeping its contents
+        void growPoolBuffer(GLuint &buffer, GLsizeiptr &capacity, GLsizeiptr used, GLsizeiptr required)
+        {
+            if (required <= capacity)
+                return;
+
+            GLsizeiptr new_capacity = capacity ? capacity : POOL_INITIAL_BYTES;
+            while (new_capacity < required)
+                new_capacity *= 2;
+
+            RenderDevice & device = RenderDevice::Current();
+            GLuint new_buffer = device.CreateBuffer();
+            device.BufferData(new_buffer, new_capacity, nullptr, GL_STATIC_DRAW);
+            if (used > 0)
+                device.CopyBufferSubData(buffer, new_buffer, 0, 0, used);
+            if (buffer)
+                GLState::DeleteBuffers(1, &buffer);
+
+            buffer = new_buffer;
+            capacity = new_capacity;
+        }
+
+        void reservePool(GLsizeiptr vertex_bytes, GLsizeiptr index_bytes)
+        {
+            RenderDevice & device = RenderDevice::Current();
+            if (!mesh_pool.VAO)
+            {
+                mesh_pool.VAO = device.CreateVertexArray();
+                device.VertexArrayAttrib(mesh_pool.VAO, 0, 3, GL_FLOAT, 0, 0);
+            }
+
+            GLuint old_vbo = mesh_pool.VBO;
+            GLuint old_ebo = mesh_pool.EBO;
+            growPoolBuffer(mesh_pool.VBO, mesh_pool.vertexCapacity, mesh_pool.vertexUsed, mesh_pool.vertexUsed + vertex_bytes);
+            growPoolBuffer(mesh_pool.EBO, mesh_pool.indexCapacity, mesh_pool.indexUsed, mesh_pool.indexUsed + index_bytes);
+
+            // Re-point the VAO only when a buffer was replaced
+            if (old_vbo != mesh_pool.VBO)
+                device.VertexArrayVertexBuffer(mesh_pool.VAO, 0, mesh_pool.VBO, 0, POOL_VERTEX_STRIDE);
+            if (old_ebo != mesh_pool.EBO)
+                device.VertexArrayElementBuffer(mesh_pool.VAO, mesh_pool.EBO);
+        }
+
+        void destroyPool()
+        {
+            if (mesh_pool.VAO)
+                GLState::DeleteVertexArrays(1, &mesh_pool.VAO);
+            if (mesh_pool.VBO)
+                GLState::DeleteBuffers(1, &mesh_pool.VBO);
+            if (mesh_pool.EBO)
+                GLState::DeleteBuffers(1, &mesh_pool.EBO);
+            mesh_pool = MeshPool{};
+        }
+
+        AssetCache<Mesh> mesh_cache;
+        AssetCache<Shader> shader_cache;
+
+        AssetCache<Mesh> & cacheFor(const Mesh *) { return mesh_cache; }
+        AssetCache<Shader> & cacheFor(const Shader *) { return shader_cache; }
+
+        void destroyAsset(Mesh &)
+        {
+            if (--mesh_pool.liveMeshes == 0)
+            {
+                mesh_pool.vertexUsed = 0;
+                mesh_pool.indexUsed = 0;
+            }
+        }
+
+        void destroyAsset(Shader & shader)
+        {
+            GLState::DeleteProgram(shader.program);
+        }
+    } // namespace
+
+    template <typename T>
+    T & AssetHandle<T>::Resolve(std::uint32_t id)
+    {
+        return cacheFor(static_cast<const T *>(nullptr)).entries[id].asset;
+    }
+
+    template <typename T>
+    void AssetHandle<T>::acquire()
+    {
+        auto & cache = cacheFor(static_cast<const T *>(nullptr));
+        if (id < cache.entries.size())
+            ++cache.entries[id].refs;
+    }
+
+    template <typename T>
+    void AssetHandle<T>::release()
+    {
+        // Handles can outlive ReleaseAll, in which case the slot is gone
+        auto & cache = cacheFor(static_cast<const T *>(nullptr));
+        if (id >= cache.entries.size() || cache.entries[id].refs == 0)
+            return;
+
+        auto & entry = cache.entries[id];
+        if (--entry.refs > 0)
+            return;
+
+        destroyAsset(entry.asset);
+        cache.lookup.erase(entry.key);
+        entry = {};
+        cache.freeSlots.push_back(id);
+    }
+
+    template class AssetHandle<Mesh>;
+    template class AssetHandle<Shader>;
+
+    ShaderHandle LoadShader(const char *vertex_shader_path, const char *fragment_shader_path)
+    {
+        PROFILE_SCOPE("ResourceLoader::LoadShader");
+        std::string key = std::string(vertex_shader_path) + "|" + fragment_shader_path;
+
+        std::uint32_t id = shader_cache.find(key);
+        if (id == ShaderHandle::INVALID)
+        {
+            Shader shader;
+            shader.program = LoadShaderGL(vertex_shader_path, fragment_shader_path);
+
+            // Reflect once so uniforms are set by slot instead of by name
+            shader.uniforms.Reflect(shader.program);
+
+            id = shader_cache.insert(key, shader);
+        }
+
+        return ShaderHandle(id);
+    }
+
+    ShaderHandle LoadComputeShader(const char *compute_shader_path)
+    {
+        PROFILE_SCOPE("ResourceLoader::LoadComputeShader");
+        std::string key = compute_shader_path;
+
+        std::uint32_t id = shader_cache.find(key);
+        if (id == ShaderHandle::INVALID)
+        {
+            Shader shader;
+            shader.program = LoadComputeShaderGL(compute_shader_path);
+            shader.uniforms.Reflect(shader.program);
+
+            id = shader_cache.insert(key, shader);
+        }
+
+        return ShaderHandle(id);
+    }
+
+    MeshHandle LoadMesh(const std::string &key, const float *vertices, GLsizeiptr vertices_size, const unsigned int *indices, GLsizei index_count)
+    {
+        PROFILE_SCOPE("ResourceLoader::LoadMesh");
+        std::uint32_t id = mesh_cache.find(key);
+        if (id != MeshHandle::INVALID)
+            return MeshHandle(id);
+
+        GLsizeiptr index_size = index_count * sizeof(unsigned int);
+        reservePool(vertices_size, index_size);
+
+        Mesh mesh;
+        mesh.VAO = mesh_pool.VAO;
+        mesh.indexCount = index_count;
+        mesh.firstIndex = static_cast<GLuint>(mesh_pool.indexUsed / sizeof(unsigned int));
+        mesh.baseVertex = static_cast<GLint>(mesh_pool.vertexUsed / POOL_VERTEX_STRIDE);
+
+        // Bounding sphere around the AABB center, used for culling
+        std::size_t vertex_count = vertices_size / POOL_VERTEX_STRIDE;
+        if (vertex_count > 0)
+        {
+            glm::vec3 min(vertices[0], vertices[1], vertices[2]);
+            glm::vec3 max = min;
+            for (std::size_t i = 1; i < vertex_count; ++i)
+            {
+                glm::vec3 v(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+                min = glm::min(min, v);
+                max = glm::max(max, v);
+            }
+
+            glm::vec3 center = (min + max) * 0.5f;
+            float radius = 0.0f;
+            for (std::size_t i = 0; i < vertex_count; ++i)
+            {
+                glm::vec3 v(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+                radius = std::max(radius, glm::length(v - center));
+            }
+            mesh.bounds = glm::vec4(center, radius);
+        }
+
+        // Append geometry to the pool
+        RenderDevice & device = RenderDevice::Current();
+        device.BufferSubData(mesh_pool.VBO, mesh_pool.vertexUsed, vertices_size, vertices);
+        device.BufferSubData(mesh_pool.EBO, mesh_pool.indexUsed, index_size, indices);
+        mesh_pool.vertexUsed += vertices_size;
+        mesh_pool.indexUsed += index_size;
+        ++mesh_pool.liveMeshes;
+
+        return MeshHandle(mesh_cache.insert(key, mesh));
+    }
+
+    void ReleaseAll()
+    {
+        PROFILE_SCOPE("ResourceLoader::ReleaseAll");
+        for (auto &entry : mesh_cache.entries)
+            if (entry.refs > 0)
+                destroyAsset(entry.asset);
+        for (auto &entry : shader_cache.entries)
+            if (entry.refs > 0)
+                destroyAsset(entry.asset);
+
+        mesh_cache = {};
+        shader_cache = {};
+
+        destroyPool();
+    }
 
     GLuint LoadShaderGL(const char *vertex_shader_path, const char *fragment_shader_path)
     {
@@ -19,7 +300,7 @@ namespace ResourceLoader
         }
         catch (std::ifstream::failure &e)
         {
-            std::cout << "ERROR::SHADER::VERTEX::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+            LOG_ERROR("ERROR::SHADER::VERTEX::FILE_NOT_SUCCESSFULLY_READ {}", vertex_shader_path);
         }
 
         // Read fragment shader
@@ -36,91 +317,58 @@ namespace ResourceLoader
         }
         catch (std::ifstream::failure &e)
         {
-            std::cout << "ERROR::SHADER::FRAGMENT::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+            LOG_ERROR("ERROR::SHADER::FRAGMENT::FILE_NOT_SUCCESSFULLY_READ {}", fragment_shader_path);
         }
 
-        const char *v_shader_code = vertex_code.c_str();
-        const char *f_shader_code = fragment_code.c_str();
-
-        // Compile shaders
-        unsigned int vertex, fragment;
-        int success;
-        char info_log[512];
-
-        // Vertex Shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &v_shader_code, NULL);
-        glCompileShader(vertex);
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(vertex, 512, NULL, info_log);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                      << info_log << std::endl;
-        }
+        // Compile and link
+        ShaderStage stages[] = {
+            {GL_VERTEX_SHADER, vertex_code.c_str()},
+            {GL_FRAGMENT_SHADER, fragment_code.c_str()}};
+        return RenderDevice::Current().CreateProgram(stages, 2);
+    }
 
-        // Fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &f_shader_code, NULL);
-        glCompileShader(fragment);
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success)
+    GLuint LoadComputeShaderGL(const char *compute_shader_path)
+    {
+        // Read compute shader
+        std::string compute_code;
+        std::ifstream c_shader_file;
+        c_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
         {
-            glGetShaderInfoLog(fragment, 512, NULL, info_log);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"
-                      << info_log << std::endl;
+            c_shader_file.open(compute_shader_path);
+            std::stringstream c_shader_stream;
+            c_shader_stream << c_shader_file.rdbuf();
+            c_shader_file.close();
+            compute_code = c_shader_stream.str();
         }
-
-        // Shader Program
-        GLuint shader_program = glCreateProgram();
-        glAttachShader(shader_program, vertex);
-        glAttachShader(shader_program, fragment);
-        glLinkProgram(shader_program);
-        glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-        if (!success)
+        catch (std::ifstream::failure &e)
         {
-            glGetProgramInfoLog(shader_program, 512, NULL, info_log);
-            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
-                      << info_log << std::endl;
+            LOG_ERROR("ERROR::SHADER::COMPUTE::FILE_NOT_SUCCESSFULLY_READ {}", compute_shader_path);
         }
 
-        // Delete shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
-        return shader_program;
+        ShaderStage stage{GL_COMPUTE_SHADER, compute_code.c_str()};
+        return RenderDevice::Current().CreateProgram(&stage, 1);
     }
 
     GLuint LoadImageGL(const char *image_file_path)
     {
+        PROFILE_SCOPE("ResourceLoader::LoadImageGL");
         SDL_Surface *surface = IMG_Load(image_file_path);
         if (!surface)
         {
-            std::cout << "Failed to load image: " << image_file_path << std::endl;
-            std::cout << "SDL_image Error: " << IMG_GetError() << std::endl;
+            LOG_ERROR("Failed to load image: {}", image_file_path);
+            LOG_ERROR("SDL_image Error: {}", IMG_GetError());
             return 0;
         }
 
-        // Create OpenGL texture
-        GLuint texture_id;
-        glGenTextures(1, &texture_id);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-
-        // Set texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Load image data into OpenGL texture
-        int mode = GL_RGB;
+        // Load image data into an OpenGL texture
+        GLenum mode = GL_RGB;
         if (surface->format->BytesPerPixel == 4)
         {
             mode = GL_RGBA;
         }
 
-        glTexImage2D(GL_TEXTURE_2D, 0, mode, surface->w, surface->h, 0, mode, GL_UNSIGNED_BYTE, surface->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        GLuint texture_id = RenderDevice::Current().CreateTexture2D(surface->w, surface->h, mode, surface->pixels);
 
         // Free the SDL_Surface
         SDL_FreeSurface(surface);
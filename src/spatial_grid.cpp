@@ -0,0 +1,168 @@
+#include <spatial_grid.h>
+#include <profiler.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <hierarchy.h>
+#include <parallel.h>
+
+void SpatialGrid::Build(const glm::vec3 * positions, std::size_t count, float cellSize)
+{
+    PROFILE_SCOPE("SpatialGrid::Build");
+    this->cellSize = cellSize;
+    inverseCellSize = 1.0f / cellSize;
+
+    std::size_t tableSize = SPATIAL_GRID_MIN_TABLE;
+    while (tableSize < count)
+        tableSize *= 2;
+    tableMask = static_cast<std::uint32_t>(tableSize - 1);
+
+    const unsigned int ranges = Parallel::RangeCount(count, SPATIAL_GRID_MIN_RANGE);
+    const unsigned int blocks = Parallel::RangeCount(tableSize, SPATIAL_GRID_MIN_TABLE);
+
+    bucketStart.resize(tableSize + 1);
+    itemBucket.resize(count);
+    itemCell.resize(count);
+    rangeCounts.resize(ranges * tableSize);
+    blockTotals.resize(blocks + 1);
+    sortedPosition.resize(count);
+    sortedIndex.resize(count);
+    sortedCell.resize(count);
+
+    // Count items per bucket, one histogram row per range
+    Parallel::For(count, SPATIAL_GRID_MIN_RANGE, [&](std::size_t begin, std::size_t end, unsigned int range) {
+        std::uint32_t * row = rangeCounts.data() + range * tableSize;
+        std::fill(row, row + tableSize, 0);
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            int x = cellCoord(positions[i].x), y = cellCoord(positions[i].y), z = cellCoord(positions[i].z);
+            std::uint32_t bucket = bucketOf(x, y, z);
+            itemBucket[i] = bucket;
+            itemCell[i] = cellKey(x, y, z);
+            ++row[bucket];
+        }
+    });
+
+    // Exclusive prefix sum over (bucket, range) in two parallel sweeps over
+    // blocks of buckets, joined by a serial sum of block totals
+    Parallel::For(tableSize, SPATIAL_GRID_MIN_TABLE, [&](std::size_t begin, std::size_t end, unsigned int block) {
+        std::uint32_t total = 0;
+        for (std::size_t bucket = begin; bucket < end; ++bucket)
+            for (unsigned int range = 0; range < ranges; ++range)
+                total += rangeCounts[range * tableSize + bucket];
+        blockTotals[block + 1] = total;
+    });
+
+    blockTotals[0] = 0;
+    for (unsigned int block = 0; block < blocks; ++block)
+        blockTotals[block + 1] += blockTotals[block];
+
+    Parallel::For(tableSize, SPATIAL_GRID_MIN_TABLE, [&](std::size_t begin, std::size_t end, unsigned int block) {
+        std::uint32_t cursor = blockTotals[block];
+        for (std::size_t bucket = begin; bucket < end; ++bucket)
+        {
+            bucketStart[bucket] = cursor;
+            for (unsigned int range = 0; range < ranges; ++range)
+            {
+                std::uint32_t & slot = rangeCounts[range * tableSize + bucket];
+                std::uint32_t n = slot;
+                slot = cursor;
+                cursor += n;
+            }
+        }
+    });
+    bucketStart[tableSize] = static_cast<std::uint32_t>(count);
+
+    // Each range scatters into its own cursors, which keeps the sort stable
+    // and the result independent of thread timing
+    Parallel::For(count, SPATIAL_GRID_MIN_RANGE, [&](std::size_t begin, std::size_t end, unsigned int range) {
+        std::uint32_t * cursors = rangeCounts.data() + range * tableSize;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            std::uint32_t slot = cursors[itemBucket[i]]++;
+            sortedPosition[slot] = positions[i];
+            sortedIndex[slot] = static_cast<std::uint32_t>(i);
+            sortedCell[slot] = itemCell[i];
+        }
+    });
+}
+
+std::size_t SpatialGrid::QueryCells(const glm::vec3 & center, float radius, GridSpan * spans, std::size_t maxSpans) const
+{
+    if (sortedIndex.empty())
+        return 0;
+
+    const int x0 = cellCoord(center.x - radius), x1 = cellCoord(center.x + radius);
+    const int y0 = cellCoord(center.y - radius), y1 = cellCoord(center.y + radius);
+    const int z0 = cellCoord(center.z - radius), z1 = cellCoord(center.z + radius);
+
+    std::size_t found = 0;
+    for (int z = z0; z <= z1; ++z)
+    {
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                std::uint32_t bucket = bucketOf(x, y, z);
+                if (bucketStart[bucket] == bucketStart[bucket + 1])
+                    continue;
+
+                // Colliding cells share a bucket; report it only once
+                GridSpan span{bucketStart[bucket], bucketStart[bucket + 1] - bucketStart[bucket]};
+                std::size_t written = std::min(found, maxSpans);
+                bool seen = std::any_of(spans, spans + written, [&](const GridSpan & s) { return s.first == span.first; });
+                if (seen)
+                    continue;
+
+                if (found < maxSpans)
+                    spans[found] = span;
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+void SpatialGrid::QueryRadius(const glm::vec3 & center, float radius, std::vector<std::uint32_t> & out) const
+{
+    ForEachInRadius(center, radius, [&](std::uint32_t slot) { out.push_back(sortedIndex[slot]); });
+}
+
+void SpatialGridSystem::Init(ECS * ecs, float cellSize)
+{
+    this->ecs = ecs;
+    this->cellSize = cellSize;
+}
+
+void SpatialGridSystem::Update()
+{
+    PROFILE_SCOPE("SpatialGridSystem::Update");
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+
+    positions.resize(mEntities.size());
+    entities.resize(mEntities.size());
+
+    std::size_t i = 0;
+    for (auto const & entity : mEntities)
+    {
+        positions[i] = glm::vec3(ecs->getComponent<Transform>(entity).world[3]);
+        entities[i] = entity.id();
+        ++i;
+    }
+
+    Clock::time_point gathered = Clock::now();
+
+    grid.Build(positions.data(), positions.size(), cellSize);
+
+    stats.entities = static_cast<unsigned int>(positions.size());
+    stats.gatherMs = std::chrono::duration<double, std::milli>(gathered - start).count();
+    stats.buildMs = std::chrono::duration<double, std::milli>(Clock::now() - gathered).count();
+}
+
+void SpatialGridSystem::QueryRadius(const glm::vec3 & center, float radius, std::vector<Entity> & out) const
+{
+    grid.ForEachInRadius(center, radius, [&](std::uint32_t slot) { out.push_back(EntityAt(slot)); });
+}
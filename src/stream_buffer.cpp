@@ -0,0 +1,98 @@
+#include <stream_buffer.h>
+
+#include <log.h>
+
+bool StreamBuffer::Init(GLenum target, GLsizeiptr frame_size)
+{
+    this->target = target;
+    create(frame_size);
+    return nullptr != mapped;
+}
+
+void StreamBuffer::Shutdown()
+{
+    for (auto & fence : fences)
+        waitFor(fence);
+    destroy();
+}
+
+void StreamBuffer::Reserve(GLsizeiptr frame_size)
+{
+    if (frame_size <= frameSize)
+        return;
+
+    // The old storage may still be read by in-flight frames
+    for (auto & fence : fences)
+        waitFor(fence);
+
+    destroy();
+    create(frame_size * 2);
+    head.store(0, std::memory_order_relaxed);
+}
+
+void StreamBuffer::BeginFrame()
+{
+    frame = (frame + 1) % STREAM_BUFFER_FRAMES;
+    waitFor(fences[frame]);
+    head.store(0, std::memory_order_relaxed);
+}
+
+StreamRange StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    // Align the offset into the whole buffer: regions start at multiples of
+    // frameSize, which need not be a multiple of alignment
+    GLintptr region = frame * frameSize;
+    GLsizeiptr offset = head.load(std::memory_order_relaxed);
+    GLsizeiptr aligned;
+    do
+    {
+        aligned = (region + offset + alignment - 1) / alignment * alignment - region;
+        if (aligned + size > frameSize)
+            return StreamRange{};
+    } while (!head.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+
+    return StreamRange{mapped + region + aligned, region + aligned, size};
+}
+
+void StreamBuffer::EndFrame()
+{
+    RenderDevice & device = RenderDevice::Current();
+    if (fences[frame])
+        device.DeleteSync(fences[frame]);
+    fences[frame] = device.FenceSync();
+}
+
+void StreamBuffer::create(GLsizeiptr frame_size)
+{
+    RenderDevice & device = RenderDevice::Current();
+
+    frameSize = frame_size;
+    buffer = device.CreateBuffer();
+    mapped = static_cast<char *>(device.MapPersistent(buffer, frameSize * STREAM_BUFFER_FRAMES));
+
+    if (!mapped)
+        LOG_ERROR("ERROR::STREAM_BUFFER::MAP_FAILED {}", device.GetError());
+}
+
+void StreamBuffer::destroy()
+{
+    if (buffer)
+    {
+        RenderDevice::Current().Unmap(buffer);
+        GLState::DeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    frameSize = 0;
+}
+
+void StreamBuffer::waitFor(GLsync & fence)
+{
+    if (!fence)
+        return;
+
+    RenderDevice & device = RenderDevice::Current();
+    device.WaitSync(fence);
+    device.DeleteSync(fence);
+    fence = nullptr;
+}
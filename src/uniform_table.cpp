@@ -0,0 +1,130 @@
+#include <uniform_table.h>
+#include <render_device.h>
+#include <log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+    std::uint64_t total_uploads = 0;
+} // namespace
+
+std::uint64_t UniformTable::TotalUploads()
+{
+    return total_uploads;
+}
+
+void UniformTable::Reflect(GLuint program)
+{
+    this->program = program;
+    slots.clear();
+
+    for (auto const & uniform : RenderDevice::Current().ActiveUniforms(program))
+    {
+        std::string uniform_name = uniform.name;
+
+        // Arrays are reported as "name[0]"; address them by their base name
+        std::size_t bracket = uniform_name.find('[');
+        if (bracket != std::string::npos)
+            uniform_name.resize(bracket);
+
+        Slot slot{UniformHash(uniform_name.c_str()), uniform.location, uniform.type, false, false, {}};
+        if (Find(slot.hash) != NOT_FOUND)
+        {
+            LOG_ERROR("ERROR::SHADER::UNIFORM::HASH_COLLISION {}", uniform_name);
+            continue;
+        }
+        slots.push_back(slot);
+    }
+}
+
+int UniformTable::Find(std::uint32_t hash) const
+{
+    for (std::size_t i = 0; i < slots.size(); ++i)
+        if (slots[i].hash == hash)
+            return static_cast<int>(i);
+    return NOT_FOUND;
+}
+
+bool UniformTable::accepts(int slot, GLenum type)
+{
+    if (slot < 0 || slot >= static_cast<int>(slots.size()))
+        return false;
+
+    auto & entry = slots[slot];
+    GLenum reflected = entry.type;
+    // Booleans take any scalar and samplers take their unit as an int
+    bool matches = reflected == type || (reflected == GL_BOOL && (type == GL_INT || type == GL_UNSIGNED_INT || type == GL_FLOAT)) ||
+                   (type == GL_INT && (reflected == GL_SAMPLER_2D || reflected == GL_SAMPLER_3D || reflected == GL_SAMPLER_CUBE ||
+                                       reflected == GL_SAMPLER_2D_ARRAY || reflected == GL_SAMPLER_2D_SHADOW));
+    if (!matches && !entry.mismatchReported)
+    {
+        LOG_ERROR("ERROR::SHADER::UNIFORM::TYPE_MISMATCH slot {} is type {}, set as {}", slot, reflected, type);
+        entry.mismatchReported = true;
+    }
+    return matches;
+}
+
+bool UniformTable::changed(int slot, const float * data, std::size_t count)
+{
+    auto & entry = slots[slot];
+    if (entry.cached && std::memcmp(entry.value.data(), data, count * sizeof(float)) == 0)
+    {
+        ++skipped;
+        return false;
+    }
+
+    std::memcpy(entry.value.data(), data, count * sizeof(float));
+    entry.cached = true;
+    ++uploads;
+    ++total_uploads;
+    return true;
+}
+
+void UniformTable::Set(int slot, float value)
+{
+    if (!accepts(slot, GL_FLOAT) || !changed(slot, &value, 1))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_FLOAT, &value);
+}
+
+void UniformTable::Set(int slot, int value)
+{
+    float bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (!accepts(slot, GL_INT) || !changed(slot, &bits, 1))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_INT, &value);
+}
+
+void UniformTable::Set(int slot, unsigned int value)
+{
+    float bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (!accepts(slot, GL_UNSIGNED_INT) || !changed(slot, &bits, 1))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_UNSIGNED_INT, &value);
+}
+
+void UniformTable::Set(int slot, const glm::vec3 & value)
+{
+    if (!accepts(slot, GL_FLOAT_VEC3) || !changed(slot, glm::value_ptr(value), 3))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_FLOAT_VEC3, glm::value_ptr(value));
+}
+
+void UniformTable::Set(int slot, const glm::vec4 & value)
+{
+    if (!accepts(slot, GL_FLOAT_VEC4) || !changed(slot, glm::value_ptr(value), 4))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_FLOAT_VEC4, glm::value_ptr(value));
+}
+
+void UniformTable::Set(int slot, const glm::mat4 & value)
+{
+    if (!accepts(slot, GL_FLOAT_MAT4) || !changed(slot, glm::value_ptr(value), 16))
+        return;
+    RenderDevice::Current().ProgramUniform(program, slots[slot].location, GL_FLOAT_MAT4, glm::value_ptr(value));
+}